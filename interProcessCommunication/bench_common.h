@@ -0,0 +1,53 @@
+#ifndef IPC_BENCH_COMMON_H
+#define IPC_BENCH_COMMON_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+
+// The timing, percentile and cache-line helpers are the ones the thread
+// examples use; this header adds what only the IPC benchmarks need.
+#include "../interThreadCommunication/bench_common.h"
+
+/**
+ * @brief Reads exactly len bytes from a stream (pipe, FIFO, stream socket).
+ * Returns 0 on success, -1 on error or if the other end closed early.
+ */
+static inline int read_full(int fd, void* buf, size_t len)
+{
+    char* p = buf;
+    while (len > 0)
+    {
+        ssize_t n = read(fd, p, len);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes exactly len bytes, retrying after short writes.
+ * Returns 0 on success, -1 on error.
+ */
+static inline int write_full(int fd, const void* buf, size_t len)
+{
+    const char* p = buf;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+#endif // IPC_BENCH_COMMON_H
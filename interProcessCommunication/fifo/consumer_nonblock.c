@@ -6,11 +6,14 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include "./fifo_constants.h"
+#include "./frame.h"
 
 int main() {
     int fifo_fd;
-    char message_buffer[MSG_BUFFER_SIZE];
-    ssize_t bytes_read;
+    static frame_reader_t reader;
+    const char* payload;
+    size_t payload_len;
+    int status;
     int messages_received = 0;
 
     printf("Consumer: Waiting to open FIFO for reading...\n");
@@ -25,17 +28,21 @@ int main() {
     printf("Consumer: Connected to FIFO. Waiting for messages.\n");
 
     // read() will return 0 when the writer closes the pipe.
-    while ((bytes_read = read(fifo_fd, message_buffer, sizeof(message_buffer))) > 0) {
-        printf("Consumer: Received <- \"%s\"\n", message_buffer);
+    // Each read() can bring in many frames; frame_read() hands them out one by one.
+    frame_reader_init(&reader, fifo_fd);
+    while ((status = frame_read(&reader, &payload, &payload_len)) > 0) {
+        printf("Consumer: Received <- \"%.*s\"\n", (int)payload_len, payload);
         messages_received++;
     }
 
-    if (bytes_read == 0) {
+    if (status == 0) {
         printf("Consumer: Producer closed the pipe. Received %d messages. Exiting.\n", messages_received);
     } else {
         perror("Consumer: Read error");
     }
 
+    frame_stats_print(&reader._stats, "Consumer", MSG_BUFFER_SIZE);
+
     close(fifo_fd);
     unlink(FIFO_PATH); // The consumer cleans up the FIFO file.
 
@@ -4,3 +4,4 @@
 #define FIFO_PATH "/tmp/my_test_fifo"
 #define MAX_MESSAGES 300
 #define MSG_BUFFER_SIZE 100
+#define MESSAGES_PER_BATCH 10 // Messages the producers send per writev()
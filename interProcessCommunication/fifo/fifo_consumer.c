@@ -5,6 +5,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include "./fifo_constants.h"
+#include "./frame.h"
 
 
 // Compile with: gcc fifo_consumer.c -o consumer
@@ -12,8 +13,10 @@
 
 int main() {
     int fifo_fd;
-    char message_buffer[MSG_BUFFER_SIZE];
-    ssize_t bytes_read;
+    static frame_reader_t reader;
+    const char* payload;
+    size_t payload_len;
+    int status;
 
     printf("Consumer: Waiting for the FIFO to be created...\n");
 
@@ -29,11 +32,13 @@ int main() {
 
     // Loop until the producer closes its end of the pipe.
     // read() will return 0 when the write-end of the pipe is closed.
-    while ((bytes_read = read(fifo_fd, message_buffer, sizeof(message_buffer))) > 0) {
-        printf("Consumer: Received <- \"%s\"\n", message_buffer);
+    // Each read() can bring in many frames; frame_read() hands them out one by one.
+    frame_reader_init(&reader, fifo_fd);
+    while ((status = frame_read(&reader, &payload, &payload_len)) > 0) {
+        printf("Consumer: Received <- \"%.*s\"\n", (int)payload_len, payload);
     }
 
-    if (bytes_read == 0) {
+    if (status == 0) {
         // End-of-file: The producer has closed its end. This is the expected exit.
         printf("Consumer: Producer closed the pipe. Exiting.\n");
     } else {
@@ -41,6 +46,8 @@ int main() {
         perror("Consumer: Read error");
     }
 
+    frame_stats_print(&reader._stats, "Consumer", MSG_BUFFER_SIZE);
+
     close(fifo_fd);
 
     // The consumer cleans up the FIFO file from the filesystem.
@@ -7,6 +7,7 @@
 #include <fcntl.h>
 #include <string.h>
 #include "./fifo_constants.h"
+#include "./frame.h"
 
 // Compile with: gcc fifo_producer.c -o producer
 
@@ -14,7 +15,9 @@
 int main()
 {
     int fifo_fd;
-    char message_buffer[MSG_BUFFER_SIZE];
+    char message_buffers[MESSAGES_PER_BATCH][MSG_BUFFER_SIZE];
+    struct iovec payloads[MESSAGES_PER_BATCH];
+    frame_stats_t stats = {0};
 
     // Create the FIFO (named pipe).
     // mkfifo returns 0 on success, -1 on error.
@@ -37,13 +40,24 @@ int main()
 
     printf("Producer: Consumer connected. Sending messages.\n");
 
-    for (int i = 0; i < MAX_MESSAGES; ++i) {
-        snprintf(message_buffer, MSG_BUFFER_SIZE, "Message #%d from producer", i);
-        printf("Producer: Sending -> \"%s\"\n", message_buffer);
-        write(fifo_fd, message_buffer, sizeof(message_buffer));
+    for (int i = 0; i < MAX_MESSAGES; i += MESSAGES_PER_BATCH) {
+        int count = 0;
+        for (; count < MESSAGES_PER_BATCH && i + count < MAX_MESSAGES; ++count) {
+            int len = snprintf(message_buffers[count], MSG_BUFFER_SIZE, "Message #%d from producer", i + count);
+            printf("Producer: Sending -> \"%s\"\n", message_buffers[count]);
+            payloads[count].iov_base = message_buffers[count];
+            payloads[count].iov_len = len;
+        }
+        // Only the payload bytes, and one writev() for the whole batch
+        if (frame_writev(fifo_fd, payloads, count, &stats) == -1) {
+            perror("Producer: write error");
+            break;
+        }
         sleep(1); // Sleep for a second to make the output easy to follow
     }
 
+    frame_stats_print(&stats, "Producer", MSG_BUFFER_SIZE);
+
     printf("Producer: Finished sending messages. Closing FIFO.\n");
     close(fifo_fd);
 
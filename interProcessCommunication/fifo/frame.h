@@ -0,0 +1,171 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+// Length-prefixed framing for pipes and FIFOs.
+//
+// Each frame is a 2-byte length followed by exactly that many payload bytes,
+// so a 12-byte message costs 14 bytes instead of a fixed-size buffer. The
+// writer gathers many frames into one writev() and the reader parses many
+// frames out of one large read().
+//
+// With several writers on one FIFO, the kernel only keeps a write intact if it
+// is at most PIPE_BUF bytes. frame_writev() therefore never puts more than
+// PIPE_BUF bytes into one call, and never splits a frame across calls, so
+// frames from different writers never interleave.
+
+#define FRAME_HEADER_SIZE sizeof(uint16_t)
+#define FRAME_MAX_PAYLOAD (PIPE_BUF - FRAME_HEADER_SIZE)
+#define FRAME_BATCH_MAX 64       // Frames per writev() call
+#define FRAME_READ_SIZE 65536    // One read() can bring in a whole pipe buffer
+
+typedef struct
+{
+    unsigned long _messages;
+    unsigned long _payload_bytes;
+    unsigned long _wire_bytes; // Payload plus headers
+    unsigned long _syscalls;
+} frame_stats_t;
+
+/**
+ * @brief Sends count payloads as frames, batching them into as few writev()
+ * calls as PIPE_BUF allows. Payloads only need to stay valid for the call.
+ * Returns 0 on success, -1 on error (errno EMSGSIZE for a payload larger than
+ * FRAME_MAX_PAYLOAD). stats may be NULL.
+ */
+static inline int frame_writev(int fd, const struct iovec* payloads, int count, frame_stats_t* stats)
+{
+    uint16_t headers[FRAME_BATCH_MAX];
+    struct iovec iov[FRAME_BATCH_MAX * 2];
+
+    int next = 0;
+    while (next < count)
+    {
+        int frames = 0;
+        size_t batch_bytes = 0;
+        size_t payload_bytes = 0;
+        while (next < count && frames < FRAME_BATCH_MAX
+               && batch_bytes + FRAME_HEADER_SIZE + payloads[next].iov_len <= PIPE_BUF)
+        {
+            headers[frames] = (uint16_t)payloads[next].iov_len;
+            iov[frames * 2].iov_base = &headers[frames];
+            iov[frames * 2].iov_len = FRAME_HEADER_SIZE;
+            iov[frames * 2 + 1] = payloads[next];
+            batch_bytes += FRAME_HEADER_SIZE + payloads[next].iov_len;
+            payload_bytes += payloads[next].iov_len;
+            frames++;
+            next++;
+        }
+        if (frames == 0)
+        {
+            errno = EMSGSIZE;
+            return -1;
+        }
+
+        // At most PIPE_BUF bytes: the pipe takes all of it or (if non-blocking
+        // and full) none of it, never a partial frame.
+        ssize_t written;
+        do
+            written = writev(fd, iov, frames * 2);
+        while (written == -1 && errno == EINTR);
+        if (written != (ssize_t)batch_bytes)
+            return -1;
+
+        if (stats)
+        {
+            stats->_messages += frames;
+            stats->_payload_bytes += payload_bytes;
+            stats->_wire_bytes += batch_bytes;
+            stats->_syscalls++;
+        }
+    }
+    return 0;
+}
+
+typedef struct
+{
+    int _fd;
+    size_t _start; // First unparsed byte in _buf
+    size_t _end;   // One past the last byte read
+    frame_stats_t _stats;
+    char _buf[FRAME_READ_SIZE];
+} frame_reader_t;
+
+static inline void frame_reader_init(frame_reader_t* reader, int fd)
+{
+    memset(&reader->_stats, 0, sizeof(reader->_stats));
+    reader->_fd = fd;
+    reader->_start = 0;
+    reader->_end = 0;
+}
+
+/**
+ * @brief Returns the next frame. *payload points into the reader's buffer and
+ * stays valid until the next call. Returns 1 for a frame, 0 at end of stream,
+ * -1 on a read error or if the stream ended in the middle of a frame.
+ */
+static inline int frame_read(frame_reader_t* reader, const char** payload, size_t* len)
+{
+    for (;;)
+    {
+        size_t available = reader->_end - reader->_start;
+        if (available >= FRAME_HEADER_SIZE)
+        {
+            uint16_t frame_len;
+            memcpy(&frame_len, reader->_buf + reader->_start, FRAME_HEADER_SIZE);
+            if (available >= FRAME_HEADER_SIZE + frame_len)
+            {
+                *payload = reader->_buf + reader->_start + FRAME_HEADER_SIZE;
+                *len = frame_len;
+                reader->_start += FRAME_HEADER_SIZE + frame_len;
+                reader->_stats._messages++;
+                reader->_stats._payload_bytes += frame_len;
+                reader->_stats._wire_bytes += FRAME_HEADER_SIZE + frame_len;
+                return 1;
+            }
+        }
+
+        // Keep the partial frame and refill behind it.
+        memmove(reader->_buf, reader->_buf + reader->_start, available);
+        reader->_start = 0;
+        reader->_end = available;
+
+        ssize_t n;
+        do
+            n = read(reader->_fd, reader->_buf + reader->_end, sizeof(reader->_buf) - reader->_end);
+        while (n == -1 && errno == EINTR);
+        reader->_stats._syscalls++;
+        if (n == 0)
+        {
+            if (available == 0)
+                return 0;
+            errno = EPROTO; // The writer went away in the middle of a frame
+            return -1;
+        }
+        if (n < 0)
+            return -1;
+        reader->_end += n;
+    }
+}
+
+/**
+ * @brief Prints what framing saved compared with one write()/read() of a
+ * fixed_size buffer per message.
+ */
+static inline void frame_stats_print(const frame_stats_t* stats, const char* who, size_t fixed_size)
+{
+    if (stats->_messages == 0)
+        return;
+    double messages = stats->_messages;
+    printf("%s: %lu messages, %lu bytes in %lu syscalls. "
+           "Versus %zu-byte fixed writes: %.1f bytes and %.2f syscalls saved per message.\n",
+           who, stats->_messages, stats->_wire_bytes, stats->_syscalls, fixed_size,
+           fixed_size - stats->_wire_bytes / messages,
+           1.0 - stats->_syscalls / messages);
+}
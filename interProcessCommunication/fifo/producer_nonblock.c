@@ -9,11 +9,14 @@
 #include <errno.h>
 
 #include "./fifo_constants.h"
+#include "./frame.h"
 
 int main() 
 {
     int fifo_fd;
-    char message_buffer[100];
+    char message_buffers[MESSAGES_PER_BATCH][MSG_BUFFER_SIZE];
+    struct iovec payloads[MESSAGES_PER_BATCH];
+    frame_stats_t stats = {0};
     int messages_sent = 0;
 
     // Create the FIFO (named pipe).
@@ -41,24 +44,31 @@ int main()
 
     printf("Producer: FIFO opened. Starting to send messages.\n");
 
-    for (int i = 0; i < MAX_MESSAGES; ++i)
+    for (int i = 0; i < MAX_MESSAGES; i += MESSAGES_PER_BATCH)
     {
-        snprintf(message_buffer, sizeof(message_buffer), "Message #%d", i);
-        
-        // The write() call will block if the pipe's buffer is full.
+        int count = 0;
+        for (; count < MESSAGES_PER_BATCH && i + count < MAX_MESSAGES; ++count)
+        {
+            int len = snprintf(message_buffers[count], MSG_BUFFER_SIZE, "Message #%d", i + count);
+            payloads[count].iov_base = message_buffers[count];
+            payloads[count].iov_len = len;
+        }
+
+        // The writev() call will block if the pipe's buffer is full.
         // This is the kernel's flow control mechanism.
-        if (write(fifo_fd, message_buffer, sizeof(message_buffer)) == -1)
+        if (frame_writev(fifo_fd, payloads, count, &stats) == -1)
         {
             perror("Producer: write error");
             break;
         }
-        else
-            printf("Producer: Sent message: %s\n", message_buffer);
+        for (int j = 0; j < count; ++j)
+            printf("Producer: Sent message: %s\n", message_buffers[j]);
 
-        messages_sent++;
+        messages_sent += count;
     }
 
     printf("Producer: Finished sending %d messages. Closing FIFO.\n", messages_sent);
+    frame_stats_print(&stats, "Producer", MSG_BUFFER_SIZE);
     close(fifo_fd);
 
     return 0;
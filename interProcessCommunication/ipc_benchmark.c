@@ -0,0 +1,530 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <semaphore.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <mqueue.h>
+
+#include "bench_common.h"
+
+// Compile with:
+// gcc -O2 ipc_benchmark.c -o ipc_benchmark -pthread   (add -lrt on glibc < 2.34)
+//
+// Usage:
+//   ./ipc_benchmark                   - every transport
+//   ./ipc_benchmark pipe unix_socket  - only the named transports
+//   ./ipc_benchmark sysv_mq posix_mq  - System V against POSIX message queues
+// Transports: pipe, fifo, unix_socket, sysv_mq, posix_mq, shared_memory.
+//
+// Runs the same two tests over every IPC mechanism in this directory, between a
+// parent and a forked child, for message sizes from 8 B to 1 MiB:
+//   - ping-pong: the parent sends a message, the child echoes it back; the
+//     round-trip time of every exchange is recorded (p50/p99/p99.9)
+//   - streaming: the parent sends messages back to back, the child acknowledges
+//     once it has received them all; reported as MB/s
+// Results are printed as CSV on stdout.
+
+#define MIN_MESSAGE_SIZE 8
+#define MAX_MESSAGE_SIZE (1024 * 1024)
+#define SIZE_STEP 8 // Sizes grow 8 B, 64 B, 512 B, ... and always end at 1 MiB
+
+#define PINGPONG_MIN_ITERS 1000   // Enough samples for a p99.9
+#define PINGPONG_MAX_ITERS 20000
+#define PINGPONG_BYTES (64L * 1024 * 1024)
+#define STREAM_MIN_MSGS 1000
+#define STREAM_MAX_MSGS 200000
+#define STREAM_BYTES (256L * 1024 * 1024)
+#define WARMUP_ITERS 100
+
+#define FIFO_P2C_PATH "/tmp/ipc_bench_p2c"
+#define FIFO_C2P_PATH "/tmp/ipc_bench_c2p"
+
+// SysV message queues cap a single message at kernel.msgmax (8192 by default),
+// so larger messages are sent as a train of chunks.
+#define MQ_CHUNK_SIZE 8192
+#define MQ_TYPE_TO_CHILD 1
+#define MQ_TYPE_TO_PARENT 2
+
+// POSIX queues have the same default cap (fs.mqueue.msgsize_max) and at most
+// fs.mqueue.msg_max (10) messages queued for an unprivileged process.
+#define POSIX_MQ_MAXMSG 10
+
+enum { SIDE_PARENT = 0, SIDE_CHILD = 1 };
+
+// One direction of the shared-memory channel: a single message slot handed
+// back and forth with two process-shared semaphores.
+typedef struct
+{
+    sem_t _full;
+    sem_t _empty;
+    char _data[MAX_MESSAGE_SIZE];
+} shm_channel_t;
+
+typedef struct transport transport_t;
+
+struct transport
+{
+    const char* _name;
+    int (*_open)(transport_t* t);                    // In the parent, before fork()
+    int (*_attach)(transport_t* t, int side);        // In each process, after fork()
+    int (*_send)(transport_t* t, int side, const void* buf, size_t len);
+    int (*_recv)(transport_t* t, int side, void* buf, size_t len);
+    void (*_close)(transport_t* t, int side);        // In each process, when done
+    void (*_destroy)(transport_t* t);                // In the parent, after the child exited
+
+    int _fds[4];
+    int _msgid;
+    mqd_t _mqds[2]; // POSIX queues: [0] parent->child, [1] child->parent
+    struct msgbuf_chunk { long _type; char _data[MQ_CHUNK_SIZE]; } *_chunk;
+    shm_channel_t* _shm; // [0] parent->child, [1] child->parent
+};
+
+// --- Pipe ---
+// _fds[0..1] parent->child pipe, _fds[2..3] child->parent pipe.
+static int pipe_open(transport_t* t)
+{
+    if (pipe(&t->_fds[0]) == -1 || pipe(&t->_fds[2]) == -1)
+        return -1;
+    return 0;
+}
+
+static int pipe_attach(transport_t* t, int side)
+{
+    if (side == SIDE_PARENT) { close(t->_fds[0]); close(t->_fds[3]); }
+    else { close(t->_fds[1]); close(t->_fds[2]); }
+    return 0;
+}
+
+static int pipe_send(transport_t* t, int side, const void* buf, size_t len)
+{
+    return write_full(side == SIDE_PARENT ? t->_fds[1] : t->_fds[3], buf, len);
+}
+
+static int pipe_recv(transport_t* t, int side, void* buf, size_t len)
+{
+    return read_full(side == SIDE_PARENT ? t->_fds[2] : t->_fds[0], buf, len);
+}
+
+static void pipe_close(transport_t* t, int side)
+{
+    if (side == SIDE_PARENT) { close(t->_fds[1]); close(t->_fds[2]); }
+    else { close(t->_fds[0]); close(t->_fds[3]); }
+}
+
+// --- FIFO ---
+// After attach, _fds[0] is this process's write end and _fds[1] its read end.
+static int fifo_open(transport_t* t)
+{
+    unlink(FIFO_P2C_PATH);
+    unlink(FIFO_C2P_PATH);
+    if (mkfifo(FIFO_P2C_PATH, 0600) == -1 || mkfifo(FIFO_C2P_PATH, 0600) == -1)
+        return -1;
+    return 0;
+}
+
+static int fifo_attach(transport_t* t, int side)
+{
+    // Both sides open the parent->child FIFO first, so the blocking opens pair up.
+    if (side == SIDE_PARENT)
+    {
+        t->_fds[0] = open(FIFO_P2C_PATH, O_WRONLY);
+        t->_fds[1] = open(FIFO_C2P_PATH, O_RDONLY);
+    }
+    else
+    {
+        t->_fds[1] = open(FIFO_P2C_PATH, O_RDONLY);
+        t->_fds[0] = open(FIFO_C2P_PATH, O_WRONLY);
+    }
+    return (t->_fds[0] == -1 || t->_fds[1] == -1) ? -1 : 0;
+}
+
+static int fifo_send(transport_t* t, int side, const void* buf, size_t len)
+{
+    return write_full(t->_fds[0], buf, len);
+}
+
+static int fifo_recv(transport_t* t, int side, void* buf, size_t len)
+{
+    return read_full(t->_fds[1], buf, len);
+}
+
+static void fifo_close(transport_t* t, int side)
+{
+    close(t->_fds[0]);
+    close(t->_fds[1]);
+}
+
+static void fifo_destroy(transport_t* t)
+{
+    unlink(FIFO_P2C_PATH);
+    unlink(FIFO_C2P_PATH);
+}
+
+// --- Unix domain socket ---
+static int socket_open(transport_t* t)
+{
+    return socketpair(AF_UNIX, SOCK_STREAM, 0, &t->_fds[0]);
+}
+
+static int socket_attach(transport_t* t, int side)
+{
+    close(t->_fds[side == SIDE_PARENT ? 1 : 0]);
+    return 0;
+}
+
+static int socket_send(transport_t* t, int side, const void* buf, size_t len)
+{
+    return write_full(t->_fds[side == SIDE_PARENT ? 0 : 1], buf, len);
+}
+
+static int socket_recv(transport_t* t, int side, void* buf, size_t len)
+{
+    return read_full(t->_fds[side == SIDE_PARENT ? 0 : 1], buf, len);
+}
+
+static void socket_close(transport_t* t, int side)
+{
+    close(t->_fds[side == SIDE_PARENT ? 0 : 1]);
+}
+
+// --- SysV message queue ---
+static int sysv_mq_open(transport_t* t)
+{
+    t->_msgid = msgget(IPC_PRIVATE, 0600 | IPC_CREAT);
+    if (t->_msgid == -1)
+        return -1;
+    t->_chunk = malloc(sizeof(*t->_chunk));
+    return t->_chunk ? 0 : -1;
+}
+
+static int sysv_mq_send(transport_t* t, int side, const void* buf, size_t len)
+{
+    const char* p = buf;
+    t->_chunk->_type = (side == SIDE_PARENT) ? MQ_TYPE_TO_CHILD : MQ_TYPE_TO_PARENT;
+    while (len > 0)
+    {
+        size_t n = len < MQ_CHUNK_SIZE ? len : MQ_CHUNK_SIZE;
+        memcpy(t->_chunk->_data, p, n);
+        if (msgsnd(t->_msgid, t->_chunk, n, 0) == -1)
+            return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int sysv_mq_recv(transport_t* t, int side, void* buf, size_t len)
+{
+    char* p = buf;
+    long type = (side == SIDE_PARENT) ? MQ_TYPE_TO_PARENT : MQ_TYPE_TO_CHILD;
+    while (len > 0)
+    {
+        ssize_t n = msgrcv(t->_msgid, t->_chunk, MQ_CHUNK_SIZE, type, 0);
+        if (n == -1)
+            return -1;
+        memcpy(p, t->_chunk->_data, n);
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static void sysv_mq_destroy(transport_t* t)
+{
+    msgctl(t->_msgid, IPC_RMID, NULL);
+    free(t->_chunk);
+}
+
+// --- POSIX message queue ---
+// One queue per direction, since POSIX queues have no message types. The
+// descriptors are inherited across fork(), so the names can go right away.
+static int posix_mq_open(transport_t* t)
+{
+    struct mq_attr attr = { 0 };
+    attr.mq_maxmsg = POSIX_MQ_MAXMSG;
+    attr.mq_msgsize = MQ_CHUNK_SIZE;
+    for (int dir = 0; dir < 2; ++dir)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "/ipc_bench_%d_%d", getpid(), dir);
+        t->_mqds[dir] = mq_open(name, O_RDWR | O_CREAT | O_EXCL, 0600, &attr);
+        if (t->_mqds[dir] == (mqd_t)-1)
+            return -1;
+        mq_unlink(name);
+    }
+    t->_chunk = malloc(sizeof(*t->_chunk));
+    return t->_chunk ? 0 : -1;
+}
+
+static int posix_mq_send(transport_t* t, int side, const void* buf, size_t len)
+{
+    const char* p = buf;
+    mqd_t mqd = t->_mqds[side == SIDE_PARENT ? 0 : 1];
+    while (len > 0)
+    {
+        size_t n = len < MQ_CHUNK_SIZE ? len : MQ_CHUNK_SIZE;
+        if (mq_send(mqd, p, n, 0) == -1)
+            return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int posix_mq_recv(transport_t* t, int side, void* buf, size_t len)
+{
+    char* p = buf;
+    mqd_t mqd = t->_mqds[side == SIDE_PARENT ? 1 : 0];
+    while (len > 0)
+    {
+        // mq_receive() wants room for a full-sized message; use the bounce
+        // buffer only for the short tail.
+        char* dst = len >= MQ_CHUNK_SIZE ? p : t->_chunk->_data;
+        ssize_t n = mq_receive(mqd, dst, MQ_CHUNK_SIZE, NULL);
+        if (n == -1)
+            return -1;
+        if (dst != p)
+            memcpy(p, dst, n);
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static void posix_mq_destroy(transport_t* t)
+{
+    mq_close(t->_mqds[0]);
+    mq_close(t->_mqds[1]);
+    free(t->_chunk);
+}
+
+// --- Shared memory ---
+static int shm_open_channel(transport_t* t)
+{
+    t->_shm = mmap(NULL, 2 * sizeof(shm_channel_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (t->_shm == MAP_FAILED)
+        return -1;
+    for (int dir = 0; dir < 2; ++dir)
+    {
+        sem_init(&t->_shm[dir]._full, 1, 0);
+        sem_init(&t->_shm[dir]._empty, 1, 1);
+    }
+    return 0;
+}
+
+static int shm_send(transport_t* t, int side, const void* buf, size_t len)
+{
+    shm_channel_t* ch = &t->_shm[side == SIDE_PARENT ? 0 : 1];
+    while (sem_wait(&ch->_empty) == -1)
+    {
+        if (errno != EINTR)
+            return -1;
+    }
+    memcpy(ch->_data, buf, len);
+    return sem_post(&ch->_full);
+}
+
+static int shm_recv(transport_t* t, int side, void* buf, size_t len)
+{
+    shm_channel_t* ch = &t->_shm[side == SIDE_PARENT ? 1 : 0];
+    while (sem_wait(&ch->_full) == -1)
+    {
+        if (errno != EINTR)
+            return -1;
+    }
+    memcpy(buf, ch->_data, len);
+    return sem_post(&ch->_empty);
+}
+
+static void shm_destroy(transport_t* t)
+{
+    for (int dir = 0; dir < 2; ++dir)
+    {
+        sem_destroy(&t->_shm[dir]._full);
+        sem_destroy(&t->_shm[dir]._empty);
+    }
+    munmap(t->_shm, 2 * sizeof(shm_channel_t));
+}
+
+static transport_t transports[] = {
+    { "pipe", pipe_open, pipe_attach, pipe_send, pipe_recv, pipe_close, NULL },
+    { "fifo", fifo_open, fifo_attach, fifo_send, fifo_recv, fifo_close, fifo_destroy },
+    { "unix_socket", socket_open, socket_attach, socket_send, socket_recv, socket_close, NULL },
+    { "sysv_mq", sysv_mq_open, NULL, sysv_mq_send, sysv_mq_recv, NULL, sysv_mq_destroy },
+    { "posix_mq", posix_mq_open, NULL, posix_mq_send, posix_mq_recv, NULL, posix_mq_destroy },
+    { "shared_memory", shm_open_channel, NULL, shm_send, shm_recv, NULL, shm_destroy },
+};
+
+#define TRANSPORT_COUNT (sizeof(transports) / sizeof(transports[0]))
+
+// --- Tests ---
+
+typedef enum { TEST_PINGPONG, TEST_STREAM } test_kind_t;
+
+/**
+ * @brief The child's half of a test: echo every message (ping-pong) or
+ * swallow them all and send a one-byte acknowledgement (streaming).
+ */
+static void run_child(transport_t* t, test_kind_t kind, size_t size, long count, char* buffer)
+{
+    if (t->_attach && t->_attach(t, SIDE_CHILD) == -1)
+        _exit(EXIT_FAILURE);
+
+    for (long i = 0; i < count; ++i)
+    {
+        if (t->_recv(t, SIDE_CHILD, buffer, size) == -1)
+            _exit(EXIT_FAILURE);
+        if (kind == TEST_PINGPONG && t->_send(t, SIDE_CHILD, buffer, size) == -1)
+            _exit(EXIT_FAILURE);
+    }
+    if (kind == TEST_STREAM && t->_send(t, SIDE_CHILD, buffer, 1) == -1)
+        _exit(EXIT_FAILURE);
+
+    if (t->_close)
+        t->_close(t, SIDE_CHILD);
+    _exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief Runs one test for one transport and message size.
+ * For ping-pong, fills samples[] with per-exchange round-trip times.
+ * Returns the elapsed time of the measured part in ns, or 0 on failure.
+ */
+static uint64_t run_test(transport_t* t, test_kind_t kind, size_t size, long count, uint64_t* samples, char* buffer)
+{
+    if (t->_open(t) == -1)
+    {
+        perror(t->_name);
+        return 0;
+    }
+
+    long total = count + (kind == TEST_PINGPONG ? WARMUP_ITERS : 0);
+    pid_t cpid = fork();
+    if (cpid == -1)
+    {
+        perror("fork");
+        return 0;
+    }
+    if (cpid == 0)
+        run_child(t, kind, size, total, buffer);
+
+    uint64_t elapsed = 0;
+    int ok = (t->_attach == NULL || t->_attach(t, SIDE_PARENT) != -1);
+
+    if (ok && kind == TEST_PINGPONG)
+    {
+        uint64_t start = 0;
+        for (long i = 0; ok && i < total; ++i)
+        {
+            if (i == WARMUP_ITERS)
+                start = now_ns();
+            uint64_t t0 = now_ns();
+            ok = t->_send(t, SIDE_PARENT, buffer, size) != -1 && t->_recv(t, SIDE_PARENT, buffer, size) != -1;
+            if (i >= WARMUP_ITERS)
+                samples[i - WARMUP_ITERS] = now_ns() - t0;
+        }
+        elapsed = now_ns() - start;
+    }
+    else if (ok)
+    {
+        uint64_t start = now_ns();
+        for (long i = 0; ok && i < total; ++i)
+            ok = t->_send(t, SIDE_PARENT, buffer, size) != -1;
+        ok = ok && t->_recv(t, SIDE_PARENT, buffer, 1) != -1;
+        elapsed = now_ns() - start;
+    }
+
+    if (t->_close)
+        t->_close(t, SIDE_PARENT);
+    int status;
+    waitpid(cpid, &status, 0);
+    if (t->_destroy)
+        t->_destroy(t);
+
+    if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        fprintf(stderr, "%s: test failed at %zu bytes\n", t->_name, size);
+        return 0;
+    }
+    return elapsed ? elapsed : 1;
+}
+
+static long clamp_count(long bytes, size_t size, long min, long max)
+{
+    long n = bytes / (long)size;
+    return n < min ? min : (n > max ? max : n);
+}
+
+static size_t next_size(size_t size)
+{
+    if (size < MAX_MESSAGE_SIZE && size * SIZE_STEP > MAX_MESSAGE_SIZE)
+        return MAX_MESSAGE_SIZE;
+    return size * SIZE_STEP;
+}
+
+static int selected(const char* name, int argc, char* argv[])
+{
+    if (argc < 2)
+        return 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], name) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    char* buffer = malloc(MAX_MESSAGE_SIZE);
+    uint64_t* samples = malloc(PINGPONG_MAX_ITERS * sizeof(uint64_t));
+    if (buffer == NULL || samples == NULL)
+    {
+        perror("malloc");
+        return 1;
+    }
+    memset(buffer, 'x', MAX_MESSAGE_SIZE);
+
+    printf("transport,size_bytes,pingpong_iters,rtt_p50_ns,rtt_p99_ns,rtt_p999_ns,stream_msgs,stream_MBps\n");
+
+    for (size_t i = 0; i < TRANSPORT_COUNT; ++i)
+    {
+        transport_t* t = &transports[i];
+        if (!selected(t->_name, argc, argv))
+            continue;
+
+        for (size_t size = MIN_MESSAGE_SIZE; size <= MAX_MESSAGE_SIZE; size = next_size(size))
+        {
+            long iters = clamp_count(PINGPONG_BYTES, size, PINGPONG_MIN_ITERS, PINGPONG_MAX_ITERS);
+            long msgs = clamp_count(STREAM_BYTES, size, STREAM_MIN_MSGS, STREAM_MAX_MSGS);
+
+            if (run_test(t, TEST_PINGPONG, size, iters, samples, buffer) == 0)
+                return 1;
+            qsort(samples, iters, sizeof(uint64_t), compare_u64);
+
+            uint64_t elapsed = run_test(t, TEST_STREAM, size, msgs, NULL, buffer);
+            if (elapsed == 0)
+                return 1;
+
+            printf("%s,%zu,%ld,%llu,%llu,%llu,%ld,%.1f\n", t->_name, size, iters,
+                   (unsigned long long)percentile_u64(samples, iters, 50),
+                   (unsigned long long)percentile_u64(samples, iters, 99),
+                   (unsigned long long)percentile_u64(samples, iters, 99.9),
+                   msgs, (double)size * msgs / (elapsed / 1e9) / 1e6);
+            fflush(stdout);
+        }
+    }
+
+    free(buffer);
+    free(samples);
+    return 0;
+}
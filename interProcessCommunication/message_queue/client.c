@@ -1,6 +1,9 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
 #include <sys/ipc.h>
 #include <sys/msg.h>
 #include <string.h>
@@ -8,6 +11,98 @@
 
 #include "msg_buffer.h"
 #include "constants.h"
+#include "../bench_common.h"
+
+// Compile with: gcc client.c -o client -pthread
+//
+// Usage:
+//   ./client               - interactive: send each line typed, print the reply
+//   ./client -b 10000 -c 8 - benchmark: 8 concurrent clients send 10000
+//                            requests each, back to back, and report
+//                            requests/sec and round-trip percentiles
+//
+// Benchmark clients are threads. Each one puts its thread id in _client_pid,
+// so the server's reply (typed with _client_pid) reaches that thread only.
+
+typedef struct
+{
+    int _msgid;
+    long _requests;
+    uint64_t* _latencies; // One round trip per request, in ns
+    long _failed;
+} bench_arg_t;
+
+void* bench_client(void* arg)
+{
+    bench_arg_t* bench = arg;
+    struct msg_buffer message;
+    pid_t my_tid = gettid();
+
+    for (long i = 0; i < bench->_requests; ++i)
+    {
+        message._msg_type = MSG_TYPE_SVR;
+        message._client_pid = my_tid;
+        snprintf(message._msg_text, sizeof(message._msg_text), "request %ld", i);
+
+        uint64_t start = now_ns();
+        if (msgsnd(bench->_msgid, &message, sizeof(message) - sizeof(long), 0) == -1
+            || msgrcv(bench->_msgid, &message, sizeof(message) - sizeof(long), my_tid, 0) == -1)
+        {
+            perror("msgsnd/msgrcv");
+            bench->_failed = bench->_requests - i;
+            break;
+        }
+        bench->_latencies[i] = now_ns() - start;
+    }
+    return NULL;
+}
+
+void run_bench(int msgid, long requests, int clients)
+{
+    pthread_t* tids = calloc(clients, sizeof(pthread_t));
+    bench_arg_t* args = calloc(clients, sizeof(bench_arg_t));
+    uint64_t* latencies = malloc(clients * requests * sizeof(uint64_t));
+    if (tids == NULL || args == NULL || latencies == NULL)
+    {
+        perror("malloc");
+        exit(1);
+    }
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < clients; ++i)
+    {
+        args[i] = (bench_arg_t){ msgid, requests, latencies + i * requests, 0 };
+        pthread_create(&tids[i], NULL, bench_client, &args[i]);
+    }
+    long failed = 0;
+    for (int i = 0; i < clients; ++i)
+    {
+        pthread_join(tids[i], NULL);
+        failed += args[i]._failed;
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    // Failed clients leave the tail of their latency range unused; count only
+    // complete runs in the percentiles.
+    size_t n = 0;
+    for (int i = 0; i < clients; ++i)
+        if (args[i]._failed == 0)
+        {
+            memmove(latencies + n, args[i]._latencies, requests * sizeof(uint64_t));
+            n += requests;
+        }
+    qsort(latencies, n, sizeof(uint64_t), compare_u64);
+
+    long done = clients * requests - failed;
+    printf("clients=%d requests=%ld failed=%ld requests_per_sec=%.0f rtt_p50_us=%.1f rtt_p99_us=%.1f\n",
+           clients, done, failed, done * 1e9 / elapsed,
+           percentile_u64(latencies, n, 50) / 1e3,
+           percentile_u64(latencies, n, 99) / 1e3);
+
+    free(latencies);
+    free(args);
+    free(tids);
+}
 
 
 // Message buffer structure for System V
@@ -20,11 +115,31 @@ void cleanup_and_exit(int sig)
 }
 
 
-int main() {
+int main(int argc, char* argv[]) {
     key_t key;
     struct msg_buffer message;
     int msgid;
     int my_pid = getpid();
+    long bench_requests = 0;
+    int bench_clients = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:c:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'b': bench_requests = atol(optarg); break;
+        case 'c': bench_clients = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-b requests [-c clients]]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (bench_requests < 0 || bench_clients < 1)
+    {
+        fprintf(stderr, "Requests and clients must be positive.\n");
+        exit(EXIT_FAILURE);
+    }
 
     signal(SIGINT, cleanup_and_exit);
     signal(SIGTERM, cleanup_and_exit);
@@ -44,6 +159,13 @@ int main() {
         exit(1);
     }
     printf("Client (PID %d): Message queue ID: %d\n", my_pid, msgid);
+
+    if (bench_requests > 0)
+    {
+        run_bench(msgid, bench_requests, bench_clients);
+        return 0;
+    }
+
     printf("Type a message and press Enter to send. Press Ctrl+C to exit.\n");
 
     while(1)
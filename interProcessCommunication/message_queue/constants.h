@@ -5,4 +5,11 @@
 #define MSG_KEY_ID 'A'             // A character to identify the project
 #define MSG_TYPE_SVR 1
 
+// POSIX message queue variant (posix_server.c / posix_client.c)
+#define POSIX_MQ_SERVER "/mq_demo_server"          // Requests from every client
+#define POSIX_MQ_CLIENT_PREFIX "/mq_demo_client_"  // Followed by the client's pid: its reply queue
+#define POSIX_MQ_STATUS_SOCKET "/tmp/mq_demo_status.sock" // Connect to read the server's stats line
+#define POSIX_MQ_MAXMSG 10                 // fs.mqueue.msg_max for unprivileged processes
+#define POSIX_MQ_REPLY_TIMEOUT_MS 2000     // How long a client waits for its reply
+
 #endif // CONSTANTS_H
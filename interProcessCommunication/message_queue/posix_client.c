@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <mqueue.h>
+
+#include "msg_buffer.h"
+#include "constants.h"
+
+// The POSIX message queue version of client.c. Replies come back on our own
+// queue, POSIX_MQ_CLIENT_PREFIX followed by our pid, and we give up on a reply
+// after POSIX_MQ_REPLY_TIMEOUT_MS instead of blocking forever on a dead server.
+//
+// Compile with: gcc posix_client.c -o posix_client   (add -lrt on glibc < 2.34)
+
+static char reply_queue_name[64];
+
+void cleanup_and_exit(int sig)
+{
+    printf("\nClient: Shutting down and cleaning up message queue...\n");
+    mq_unlink(reply_queue_name);
+    exit(0);
+}
+
+int main()
+{
+    struct msg_buffer message;
+    int my_pid = getpid();
+
+    signal(SIGINT, cleanup_and_exit);
+    signal(SIGTERM, cleanup_and_exit);
+
+    // 1. Create our reply queue before the server can try to answer
+    snprintf(reply_queue_name, sizeof(reply_queue_name), POSIX_MQ_CLIENT_PREFIX "%d", my_pid);
+    struct mq_attr attr = { 0 };
+    attr.mq_maxmsg = POSIX_MQ_MAXMSG;
+    attr.mq_msgsize = sizeof(struct msg_buffer);
+    mqd_t reply_mq = mq_open(reply_queue_name, O_RDONLY | O_CREAT | O_EXCL, 0600, &attr);
+    if (reply_mq == (mqd_t)-1)
+    {
+        perror("mq_open (reply queue)");
+        exit(1);
+    }
+
+    // 2. Open the server's queue
+    mqd_t server_mq = mq_open(POSIX_MQ_SERVER, O_WRONLY);
+    if (server_mq == (mqd_t)-1)
+    {
+        perror("mq_open (server queue)");
+        mq_unlink(reply_queue_name);
+        exit(1);
+    }
+    printf("Client (PID %d): Replies on %s\n", my_pid, reply_queue_name);
+    printf("Type a message and press Enter to send. Press Ctrl+C to exit.\n");
+
+    while (1)
+    {
+        printf("> ");
+        if (fgets(message._msg_text, sizeof(message._msg_text), stdin) == NULL)
+            break;
+
+        // Remove the newline character from the input
+        message._msg_text[strcspn(message._msg_text, "\n")] = 0;
+
+        message._msg_type = MSG_TYPE_SVR;
+        message._client_pid = my_pid;
+
+        if (mq_send(server_mq, (const char*)&message, sizeof(message), 0) == -1)
+        {
+            perror("mq_send");
+            break;
+        }
+
+        // 3. Wait for the reply, but not forever. The timeout is an absolute
+        // CLOCK_REALTIME time.
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += POSIX_MQ_REPLY_TIMEOUT_MS / 1000;
+        deadline.tv_nsec += (POSIX_MQ_REPLY_TIMEOUT_MS % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        if (mq_timedreceive(reply_mq, (char*)&message, sizeof(message), NULL, &deadline) == -1)
+        {
+            if (errno == ETIMEDOUT)
+            {
+                printf("Client (PID %d): No reply within %d ms\n", my_pid, POSIX_MQ_REPLY_TIMEOUT_MS);
+                continue;
+            }
+            perror("mq_timedreceive");
+            break;
+        }
+        printf("Client (PID %d): Received reply: \"%s\"\n", my_pid, message._msg_text);
+    }
+
+    printf("Client (PID %d): Shutting down and cleaning up message queue...\n", my_pid);
+    mq_close(server_mq);
+    mq_close(reply_mq);
+    mq_unlink(reply_queue_name);
+
+    return 0;
+}
@@ -0,0 +1,294 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <mqueue.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "msg_buffer.h"
+#include "constants.h"
+
+// The POSIX message queue version of server.c.
+//
+// On Linux an mqd_t is a file descriptor, so one epoll loop serves everything
+// without a blocking mq_receive():
+//   - the request queue, opened O_NONBLOCK and drained until EAGAIN,
+//   - a timerfd that prints the stats every STATS_INTERVAL_SEC,
+//   - a signalfd for SIGINT/SIGTERM, so cleanup (mq_unlink) runs in the loop
+//     instead of in a signal handler,
+//   - a Unix socket at POSIX_MQ_STATUS_SOCKET: connect and read one stats line
+//     (e.g. `nc -U /tmp/mq_demo_status.sock`).
+// POSIX queues have no message types, so each client has its own reply queue,
+// POSIX_MQ_CLIENT_PREFIX followed by its pid. The server keeps the last few
+// reply queues open instead of calling mq_open() for every reply.
+//
+// Compile with: gcc posix_server.c -o posix_server   (add -lrt on glibc < 2.34)
+
+#define STATS_INTERVAL_SEC 5
+#define REPLY_CACHE_SIZE 16
+#define MAX_EVENTS 8
+
+typedef struct
+{
+    pid_t _pid;          // 0 when unused
+    mqd_t _mqd;
+    unsigned long _used; // Request counter value at the last use, for LRU eviction
+} reply_queue_t;
+
+typedef struct
+{
+    unsigned long _requests;
+    unsigned long _replies;
+    unsigned long _dropped;    // Replies to clients whose queue is gone or full
+    unsigned long _drains;     // Wake-ups of the request queue
+    unsigned long _mq_opens;   // Reply queues opened (cache misses)
+    unsigned long _status_requests;
+} server_stats_t;
+
+static reply_queue_t reply_cache[REPLY_CACHE_SIZE];
+static server_stats_t stats;
+
+static int format_stats(char* buf, size_t size)
+{
+    return snprintf(buf, size,
+                    "requests=%lu replies=%lu dropped=%lu drains=%lu msgs_per_drain=%.2f mq_opens=%lu status_requests=%lu\n",
+                    stats._requests, stats._replies, stats._dropped, stats._drains,
+                    stats._drains ? (double)stats._requests / stats._drains : 0.0,
+                    stats._mq_opens, stats._status_requests);
+}
+
+/**
+ * @brief Returns the reply queue of pid, opening it (and evicting the least
+ * recently used entry) on a miss. Returns NULL if the client's queue does not exist.
+ */
+static reply_queue_t* reply_queue_get(pid_t pid)
+{
+    reply_queue_t* victim = &reply_cache[0];
+    for (int i = 0; i < REPLY_CACHE_SIZE; i++)
+    {
+        if (reply_cache[i]._pid == pid)
+        {
+            reply_cache[i]._used = stats._requests;
+            return &reply_cache[i];
+        }
+        if (reply_cache[i]._pid == 0 || (victim->_pid != 0 && reply_cache[i]._used < victim->_used))
+            victim = &reply_cache[i];
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), POSIX_MQ_CLIENT_PREFIX "%d", pid);
+    // Non-blocking: one client that stops reading must not stall the others.
+    mqd_t mqd = mq_open(name, O_WRONLY | O_NONBLOCK);
+    if (mqd == (mqd_t)-1)
+        return NULL;
+    stats._mq_opens++;
+
+    if (victim->_pid != 0)
+        mq_close(victim->_mqd);
+    victim->_pid = pid;
+    victim->_mqd = mqd;
+    victim->_used = stats._requests;
+    return victim;
+}
+
+static void reply_queue_drop(reply_queue_t* entry)
+{
+    mq_close(entry->_mqd);
+    entry->_pid = 0;
+}
+
+static void handle_request(struct msg_buffer* message)
+{
+    stats._requests++;
+    printf("Server: Received message from PID %d: \"%s\"\n", message->_client_pid, message->_msg_text);
+
+    pid_t pid = message->_client_pid;
+    snprintf(message->_msg_text, sizeof(message->_msg_text), "Acknowledged your message, client %d!", pid);
+
+    reply_queue_t* entry = reply_queue_get(pid);
+    if (entry == NULL)
+    {
+        stats._dropped++;
+        return;
+    }
+    if (mq_send(entry->_mqd, (const char*)message, sizeof(*message), 0) == -1)
+    {
+        // Full, or the client exited and its queue was unlinked: forget it.
+        stats._dropped++;
+        reply_queue_drop(entry);
+        return;
+    }
+    stats._replies++;
+}
+
+/**
+ * @brief Receives every queued request. With an edge-triggered epoll, the
+ * queue must be emptied before waiting again.
+ */
+static void drain_requests(mqd_t server_mq)
+{
+    struct msg_buffer message;
+    stats._drains++;
+    for (;;)
+    {
+        ssize_t n = mq_receive(server_mq, (char*)&message, sizeof(message), NULL);
+        if (n == -1)
+        {
+            if (errno != EAGAIN && errno != EINTR)
+                perror("mq_receive");
+            if (errno != EINTR)
+                return;
+            continue;
+        }
+        if (n != sizeof(message))
+            continue;
+        message._msg_text[sizeof(message._msg_text) - 1] = '\0';
+        handle_request(&message);
+    }
+}
+
+static int open_status_socket(void)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+        return -1;
+
+    struct sockaddr_un addr = { 0 };
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, POSIX_MQ_STATUS_SOCKET, sizeof(addr.sun_path) - 1);
+    unlink(POSIX_MQ_STATUS_SOCKET);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(fd, 8) == -1)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void answer_status(int listen_fd)
+{
+    int fd;
+    while ((fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC)) != -1)
+    {
+        char line[256];
+        int len = format_stats(line, sizeof(line));
+        stats._status_requests++;
+        if (write(fd, line, len) != len)
+            perror("write (status)");
+        close(fd);
+    }
+}
+
+static int epoll_add(int epfd, int fd, uint32_t events)
+{
+    struct epoll_event ev = { 0 };
+    ev.events = events;
+    ev.data.fd = fd;
+    return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+int main()
+{
+    // Signals arrive through the signalfd, so block their default action.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+    int sig_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    struct mq_attr attr = { 0 };
+    attr.mq_maxmsg = POSIX_MQ_MAXMSG;
+    attr.mq_msgsize = sizeof(struct msg_buffer);
+    mqd_t server_mq = mq_open(POSIX_MQ_SERVER, O_RDONLY | O_CREAT | O_NONBLOCK, 0666, &attr);
+    if (server_mq == (mqd_t)-1)
+    {
+        perror("mq_open");
+        exit(1);
+    }
+
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct itimerspec interval = { { STATS_INTERVAL_SEC, 0 }, { STATS_INTERVAL_SEC, 0 } };
+    int status_fd = open_status_socket();
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (sig_fd == -1 || timer_fd == -1 || timerfd_settime(timer_fd, 0, &interval, NULL) == -1
+        || status_fd == -1 || epfd == -1
+        || epoll_add(epfd, server_mq, EPOLLIN | EPOLLET) == -1
+        || epoll_add(epfd, sig_fd, EPOLLIN) == -1
+        || epoll_add(epfd, timer_fd, EPOLLIN) == -1
+        || epoll_add(epfd, status_fd, EPOLLIN) == -1)
+    {
+        perror("setup");
+        mq_unlink(POSIX_MQ_SERVER);
+        exit(1);
+    }
+
+    printf("Server: POSIX message queue %s ready, status on %s\n", POSIX_MQ_SERVER, POSIX_MQ_STATUS_SOCKET);
+    printf("Server: Waiting for messages... (Press Ctrl+C to shut down)\n\n");
+
+    // Requests queued before the queue was registered produce no edge.
+    drain_requests(server_mq);
+
+    int running = 1;
+    while (running)
+    {
+        struct epoll_event events[MAX_EVENTS];
+        int n = epoll_wait(epfd, events, MAX_EVENTS, -1);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == server_mq)
+                drain_requests(server_mq);
+            else if (fd == timer_fd)
+            {
+                uint64_t expirations;
+                if (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+                {
+                    char line[256];
+                    format_stats(line, sizeof(line));
+                    printf("Server stats: %s", line);
+                }
+            }
+            else if (fd == status_fd)
+                answer_status(status_fd);
+            else if (fd == sig_fd)
+            {
+                struct signalfd_siginfo info;
+                if (read(sig_fd, &info, sizeof(info)) == sizeof(info))
+                    running = 0;
+            }
+        }
+    }
+
+    printf("\nServer: Shutting down and cleaning up message queue...\n");
+    for (int i = 0; i < REPLY_CACHE_SIZE; i++)
+        if (reply_cache[i]._pid != 0)
+            reply_queue_drop(&reply_cache[i]);
+    mq_close(server_mq);
+    if (mq_unlink(POSIX_MQ_SERVER) == -1)
+        perror("mq_unlink (cleanup)");
+    unlink(POSIX_MQ_STATUS_SOCKET);
+    close(status_fd);
+    close(timer_fd);
+    close(sig_fd);
+    close(epfd);
+    return 0;
+}
@@ -3,11 +3,34 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <sys/ipc.h>
 #include <sys/msg.h>
 
 #include "msg_buffer.h"
 #include "constants.h"
+#include "../bench_common.h"
+
+// Compile with: gcc server.c -o server -pthread
+//
+// Usage:
+//   ./server        - one request at a time, printing each one (the demo)
+//   ./server -w 4   - 4 worker threads all receiving MSG_TYPE_SVR and replying
+//                     concurrently; prints requests/sec every second and the
+//                     per-worker counts on Ctrl+C. Load it with `client -b`.
+//
+// The kernel hands each message to exactly one of the threads blocked in
+// msgrcv() on the queue, so the workers need no locking of their own.
+
+typedef struct
+{
+    _Alignas(CACHE_LINE_SIZE) _Atomic unsigned long _requests; // Own cache line: workers never share one
+    _Atomic unsigned long _errors;
+    int _id;
+} worker_t;
 
 // Message buffer structure for System V
 // The first member MUST be of type long.
@@ -27,10 +50,127 @@ void cleanup_and_exit(int sig)
     exit(0);
 }
 
-int main()
+/**
+ * @brief Receives and answers requests until the queue is removed. Nothing is
+ * printed per request and there is no pause between them.
+ */
+void* worker_loop(void* arg)
+{
+    worker_t* worker = arg;
+    struct msg_buffer message;
+
+    for (;;)
+    {
+        if (msgrcv(msgid, &message, sizeof(message) - sizeof(long), MSG_TYPE_SVR, 0) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EIDRM && errno != EINVAL) // The queue was removed: shutting down
+                perror("msgrcv");
+            break;
+        }
+
+        message._msg_type = message._client_pid;
+        snprintf(message._msg_text, sizeof(message._msg_text), "Acknowledged your message, client %d!", message._client_pid);
+        if (msgsnd(msgid, &message, sizeof(message) - sizeof(long), 0) == -1)
+            atomic_fetch_add_explicit(&worker->_errors, 1, memory_order_relaxed);
+        else
+            atomic_fetch_add_explicit(&worker->_requests, 1, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Runs the worker pool until SIGINT/SIGTERM, then removes the queue
+ * (which wakes every worker with EIDRM) and prints what each worker did.
+ */
+void run_worker_pool(int workers)
+{
+    // Only this thread takes the signals; the workers inherit the blocked mask.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    worker_t* pool = aligned_alloc(CACHE_LINE_SIZE, workers * sizeof(worker_t));
+    pthread_t* tids = calloc(workers, sizeof(pthread_t));
+    if (pool == NULL || tids == NULL)
+    {
+        perror("malloc");
+        cleanup_and_exit(0);
+    }
+    for (int i = 0; i < workers; ++i)
+    {
+        atomic_init(&pool[i]._requests, 0);
+        atomic_init(&pool[i]._errors, 0);
+        pool[i]._id = i;
+        if (pthread_create(&tids[i], NULL, worker_loop, &pool[i]) != 0)
+        {
+            perror("pthread_create");
+            cleanup_and_exit(0);
+        }
+    }
+    printf("Server: %d workers receiving on type %d. Press Ctrl+C for per-worker counts.\n", workers, MSG_TYPE_SVR);
+
+    unsigned long last_total = 0;
+    uint64_t last_ns = now_ns();
+    const struct timespec second = { 1, 0 };
+    while (sigtimedwait(&signals, NULL, &second) == -1)
+    {
+        unsigned long total = 0;
+        for (int i = 0; i < workers; ++i)
+            total += atomic_load_explicit(&pool[i]._requests, memory_order_relaxed);
+        uint64_t now = now_ns();
+        if (total != last_total)
+            printf("Server: %.0f requests/sec\n", (total - last_total) * 1e9 / (now - last_ns));
+        last_total = total;
+        last_ns = now;
+    }
+
+    printf("\nServer: Shutting down and cleaning up message queue...\n");
+    if (msgctl(msgid, IPC_RMID, NULL) == -1)
+        perror("msgctl (cleanup)");
+    msgid = -1;
+
+    unsigned long total = 0;
+    for (int i = 0; i < workers; ++i)
+    {
+        pthread_join(tids[i], NULL);
+        unsigned long requests = atomic_load_explicit(&pool[i]._requests, memory_order_relaxed);
+        unsigned long errors = atomic_load_explicit(&pool[i]._errors, memory_order_relaxed);
+        printf("Server: worker %d answered %lu requests (%lu failed replies)\n", pool[i]._id, requests, errors);
+        total += requests;
+    }
+    printf("Server: %lu requests in total\n", total);
+    free(tids);
+    free(pool);
+}
+
+int main(int argc, char* argv[])
 {
     key_t key;
     struct msg_buffer message;
+    int workers = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'w':
+            workers = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-w workers]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (workers < 0)
+    {
+        fprintf(stderr, "The number of workers can't be negative.\n");
+        exit(EXIT_FAILURE);
+    }
 
     signal(SIGINT, cleanup_and_exit);
     signal(SIGTERM, cleanup_and_exit);
@@ -56,6 +196,13 @@ int main()
         exit(1);
     }
     printf("Server: Message queue created with ID: %d\n", msgid);
+
+    if (workers > 0)
+    {
+        run_worker_pool(workers);
+        return 0;
+    }
+
     printf("Server: Waiting for messages... (Press Ctrl+C to shut down)\n\n");
 
     while (1)
@@ -0,0 +1,253 @@
+#ifndef DATA_ARENA_H
+#define DATA_ARENA_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// The content of downloaded files, kept once in shared memory.
+//
+// The arena is a separate segment from the table, so consumers can attach it
+// read-only: the downloader writes its chunks straight into the arena and
+// every other process maps the completed file in place. However many processes
+// use a file, it exists in one physical copy and nobody copies it.
+//
+// Space is handed out in slabs of DATA_SLAB_SIZE. A file gets a run of a
+// power-of-two number of slabs, aligned to its own size, and released runs go
+// on a free list per size class. A request is served from its class, then from
+// never-used space, then by splitting a larger free run. Runs are not merged
+// back; with files of one size, as here, nothing fragments.
+//
+// The allocator state (data_arena_t) is metadata and lives in the table, under
+// the table's lock; the arena segment holds nothing but file bytes.
+
+#define DATA_SLAB_SIZE (1 << 20)                                        // 1 MiB
+#define DATA_ARENA_SLABS 1024
+#define DATA_ARENA_SIZE ((size_t)DATA_ARENA_SLABS * DATA_SLAB_SIZE)     // 1 GiB, touched only as used
+#define DATA_SLAB_CLASSES 11                                            // Runs of 1, 2, 4 ... 1024 slabs
+#define DATA_SLAB_USED UINT32_MAX                                       // Marks slabs in use while rebuilding
+
+typedef struct {
+    uint32_t _free[DATA_SLAB_CLASSES];  // First free run of each class, slab index + 1, 0 when empty
+    uint32_t _next[DATA_ARENA_SLABS];   // Free list link of the run starting at that slab
+    uint32_t _bump;                     // Slabs below this have been handed out at least once
+    _Atomic uint64_t _bytes_in_use;     // Allocated bytes, read by monitors
+} data_arena_t;
+
+static inline void data_arena_init(data_arena_t* arena)
+{
+    memset(arena->_free, 0, sizeof(arena->_free));
+    memset(arena->_next, 0, sizeof(arena->_next));
+    arena->_bump = 0;
+    atomic_store_explicit(&arena->_bytes_in_use, 0, memory_order_relaxed);
+}
+
+static inline void data_arena_push(data_arena_t* arena, uint32_t slab, int size_class)
+{
+    arena->_next[slab] = arena->_free[size_class];
+    arena->_free[size_class] = slab + 1;
+}
+
+/**
+ * @brief Puts the slabs [from, to) on the free lists as the largest aligned
+ * runs that fit.
+ */
+static inline void data_arena_push_range(data_arena_t* arena, uint32_t from, uint32_t to)
+{
+    while (from < to)
+    {
+        int size_class = 0;
+        while (size_class + 1 < DATA_SLAB_CLASSES && from % (2u << size_class) == 0
+               && from + (2u << size_class) <= to)
+            size_class++;
+        data_arena_push(arena, from, size_class);
+        from += 1u << size_class;
+    }
+}
+
+/**
+ * @brief Allocates room for bytes. Stores the run's byte offset into the arena
+ * and its size (bytes rounded up to a power-of-two number of slabs), and
+ * returns 0, or -1 if the arena has no run that large left.
+ */
+static inline int data_arena_alloc(data_arena_t* arena, uint64_t bytes, uint64_t* offset, uint64_t* capacity)
+{
+    int size_class = 0;
+    while (((uint64_t)DATA_SLAB_SIZE << size_class) < bytes)
+        if (++size_class == DATA_SLAB_CLASSES)
+            return -1;
+    uint32_t run = 1u << size_class;
+
+    uint32_t slab;
+    uint32_t aligned = (arena->_bump + run - 1) & ~(run - 1);
+    if (arena->_free[size_class] != 0)
+    {
+        slab = arena->_free[size_class] - 1;
+        arena->_free[size_class] = arena->_next[slab];
+    }
+    else if (aligned + run <= DATA_ARENA_SLABS)
+    {
+        data_arena_push_range(arena, arena->_bump, aligned); // Keep the alignment gap usable
+        slab = aligned;
+        arena->_bump = aligned + run;
+    }
+    else
+    {
+        int larger = size_class + 1;
+        while (larger < DATA_SLAB_CLASSES && arena->_free[larger] == 0)
+            larger++;
+        if (larger == DATA_SLAB_CLASSES)
+            return -1;
+        slab = arena->_free[larger] - 1;
+        arena->_free[larger] = arena->_next[slab];
+        while (larger-- > size_class) // Give back the upper halves
+            data_arena_push(arena, slab + (1u << larger), larger);
+    }
+
+    *offset = (uint64_t)slab * DATA_SLAB_SIZE;
+    *capacity = (uint64_t)run * DATA_SLAB_SIZE;
+    atomic_fetch_add_explicit(&arena->_bytes_in_use, *capacity, memory_order_relaxed);
+    return 0;
+}
+
+/**
+ * @brief Returns a run from data_arena_alloc() to its free list.
+ */
+static inline void data_arena_free(data_arena_t* arena, uint64_t offset, uint64_t capacity)
+{
+    int size_class = 0;
+    while (((uint64_t)DATA_SLAB_SIZE << size_class) < capacity)
+        size_class++;
+    data_arena_push(arena, offset / DATA_SLAB_SIZE, size_class);
+    atomic_fetch_sub_explicit(&arena->_bytes_in_use, capacity, memory_order_relaxed);
+}
+
+/**
+ * @brief Recovery: claims a run read back from a slot after data_arena_init().
+ * Returns -1 if it is not a run data_arena_alloc() could have made or
+ * overlaps one already claimed, in which case the slot's content is lost.
+ */
+static inline int data_arena_mark(data_arena_t* arena, uint64_t offset, uint64_t capacity)
+{
+    uint64_t run = capacity / DATA_SLAB_SIZE;
+    uint64_t slab = offset / DATA_SLAB_SIZE;
+    if (offset % DATA_SLAB_SIZE != 0 || capacity % DATA_SLAB_SIZE != 0 || run == 0 || (run & (run - 1)) != 0
+        || slab % run != 0 || slab + run > DATA_ARENA_SLABS)
+        return -1;
+    for (uint64_t i = slab; i < slab + run; i++)
+        if (arena->_next[i] == DATA_SLAB_USED)
+            return -1;
+    for (uint64_t i = slab; i < slab + run; i++)
+        arena->_next[i] = DATA_SLAB_USED;
+    if (slab + run > arena->_bump)
+        arena->_bump = slab + run;
+    atomic_fetch_add_explicit(&arena->_bytes_in_use, capacity, memory_order_relaxed);
+    return 0;
+}
+
+/**
+ * @brief Recovery: frees every slab below _bump that no data_arena_mark()
+ * claimed.
+ */
+static inline void data_arena_collect_holes(data_arena_t* arena)
+{
+    uint32_t slab = 0;
+    while (slab < arena->_bump)
+    {
+        if (arena->_next[slab] == DATA_SLAB_USED)
+        {
+            slab++;
+            continue;
+        }
+        uint32_t end = slab;
+        while (end < arena->_bump && arena->_next[end] != DATA_SLAB_USED)
+            end++;
+        data_arena_push_range(arena, slab, end);
+        slab = end;
+    }
+}
+
+// --- Mapping the arena ---
+
+/**
+ * @brief Maps the arena: the file at path when the table is persistent,
+ * otherwise the SysV segment for key. Consumers pass writable 0 and get a
+ * PROT_READ / SHM_RDONLY mapping; only a downloader maps it writable. Returns
+ * the base address, or NULL with a message printed.
+ */
+static inline char* data_arena_map(const char* path, key_t key, int writable)
+{
+    if (path == NULL)
+    {
+        // SHM_NORESERVE: only the slabs actually written take memory
+        int shmid = shmget(key, DATA_ARENA_SIZE, 0666 | IPC_CREAT | SHM_NORESERVE);
+        if (shmid == -1)
+        {
+            perror("shmget data arena");
+            return NULL;
+        }
+        char* base = shmat(shmid, NULL, writable ? 0 : SHM_RDONLY);
+        if (base == (void*)-1)
+        {
+            perror("shmat data arena");
+            return NULL;
+        }
+        return base;
+    }
+
+    int fd = open(path, writable ? O_RDWR | O_CREAT : O_RDONLY, 0666);
+    if (fd == -1)
+    {
+        perror("open data arena");
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || ((size_t)st.st_size != DATA_ARENA_SIZE
+                                 && (!writable || ftruncate(fd, DATA_ARENA_SIZE) == -1)))
+    {
+        fprintf(stderr, "data arena %s has the wrong size\n", path);
+        close(fd);
+        return NULL;
+    }
+    char* base = mmap(NULL, DATA_ARENA_SIZE, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file referenced
+    if (base == MAP_FAILED)
+    {
+        perror("mmap data arena");
+        return NULL;
+    }
+    return base;
+}
+
+static inline void data_arena_unmap(const char* path, char* base)
+{
+    if (path == NULL)
+        shmdt(base);
+    else
+        munmap(base, DATA_ARENA_SIZE);
+}
+
+/**
+ * @brief A cheap fingerprint of a file's bytes, so processes can show they see
+ * the same content.
+ */
+static inline uint64_t data_checksum(const char* data, size_t bytes)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ull;
+    }
+    return hash ^ (hash >> 32); // The multiply leaves the low bits poorly mixed
+}
+
+#endif // DATA_ARENA_H
@@ -0,0 +1,582 @@
+#ifndef DOWNLOAD_TABLE_H
+#define DOWNLOAD_TABLE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <sys/types.h>
+
+#include "futex.h"
+#include "data_arena.h"
+
+// The download table shared by both downloader clients (mutex/ and semaphore/).
+// It lives inside the shared segment, so it holds no pointers, only indices
+// and offsets.
+//
+//   _index    open-addressing hash index, 64-bit FNV-1a of the file name to
+//             slot. Linear probing; removed entries become tombstones and the
+//             index is rebuilt when tombstones pile up.
+//   _slots    the download slots. Never-used slots are handed out in order,
+//             released ones go on a free list, so claiming a slot is O(1).
+//   _strings  every file name once, NUL-terminated, appended as slots are
+//             claimed. Slots refer to their name by offset. When it fills up
+//             the names of released slots are squeezed out in place.
+//   _arena    the allocator for file content, which lives in a separate
+//             segment (data_arena.h). Each slot records the run it owns, so
+//             memory use is accounted per slot.
+//
+// A table that is full recycles completed slots nobody is using, picked by
+// CLOCK: every slot in use holds one reference per process using its content
+// (_refs), a hit sets _referenced, and the hand sweeps the slots, giving
+// referenced ones a second chance and evicting the first unreferenced one.
+// Hits, misses and evictions are counted in the table for the monitor. A
+// process killed while using a file leaves its reference behind, pinning the
+// slot until the table is next reattached with nobody else attached.
+//
+// Lookups hash the name, probe a few index entries (which carry the full hash,
+// so collisions almost never touch a slot) and make one strcmp. The table
+// functions must be called with the table's lock held.
+//
+// A slot's status and progress are also published through a sequence lock in
+// _seq, so they can be read with no lock at all (slot_read). The writer makes
+// _seq odd, updates the fields and makes it even again; a reader copies the
+// fields between two loads of _seq and retries if they differ or are odd.
+// Readers never write to the segment, so any number of waiters and monitors
+// can poll without slowing the downloaders. Each slot has one writer at a
+// time: the claiming downloader for progress, the lock holder for the
+// claim/complete/remove transitions.
+
+#define MAX_DOWNLOADS (1 << 17)
+#define DOWNLOAD_INDEX_SIZE (MAX_DOWNLOADS * 2) // Power of two; at most half full
+#define STRING_TABLE_SIZE (MAX_DOWNLOADS * 64)  // Room for an average 63-byte name
+
+#define FILE_NAME_SIZE 256 // Longest accepted name, including the NUL
+#define STRING_TABLE_SLACK (STRING_TABLE_SIZE / 8) // Room a compaction makes, evicting if need be
+
+// Bump whenever the layout of the table changes: persistent segments written
+// with another layout are then discarded instead of misread.
+#define DOWNLOAD_TABLE_VERSION 3
+
+#define INDEX_EMPTY 0
+#define INDEX_TOMBSTONE UINT32_MAX
+
+typedef enum
+{
+    STATUS_EMPTY = 0,
+    STATUS_IN_PROGRESS,
+    STATUS_COMPLETED
+} download_status_t;
+
+// Fields marked (seq) are written between slot_write_begin() and
+// slot_write_end(); they are atomics only so lock-free readers race on them
+// legally, every access in the seqlock is relaxed.
+typedef struct {
+    _Atomic download_status_t _status;   // (seq)
+    _Atomic pid_t _downloader_pid;       // (seq)
+    _Atomic uint64_t _name_hash;         // (seq)
+    _Atomic uint32_t _name_offset;       // (seq) Into _strings
+    uint32_t _next_free;                 // Free list link (slot index + 1) while the slot is released
+    _Atomic long _bytes_downloaded;      // (seq)
+    _Atomic long _total_bytes;           // (seq)
+    _Atomic uint32_t _seq;               // Sequence lock, odd while being written; waiters sleep on it
+    _Atomic uint64_t _completed_ns;      // (seq) CLOCK_MONOTONIC time the download was marked complete
+    _Atomic uint64_t _data_offset;       // (seq) Start of the content in the data arena
+    _Atomic uint64_t _data_capacity;     // (seq) Arena bytes the slot owns, 0 if none
+    _Atomic uint32_t _refs;              // Processes using the slot; evictable at 0 once completed
+    uint32_t _referenced;                // CLOCK bit: used since the hand last passed
+} download_slot_t;
+
+// A consistent copy of a slot's (seq) fields, taken by slot_read().
+typedef struct {
+    download_status_t _status;
+    pid_t _downloader_pid;
+    uint64_t _name_hash;
+    uint32_t _name_offset;
+    long _bytes_downloaded;
+    long _total_bytes;
+    uint64_t _completed_ns;
+    uint64_t _data_offset;
+    uint64_t _data_capacity;
+    uint32_t _seq; // The even sequence the copy was taken at; pass it to slot_wait()
+} download_snapshot_t;
+
+typedef struct {
+    uint64_t _hash;
+    uint32_t _slot; // INDEX_EMPTY, INDEX_TOMBSTONE or slot index + 1
+} download_index_entry_t;
+
+typedef struct {
+    _Atomic uint32_t _slots_used; // Slots ever handed out; the rest were never touched (read by monitors)
+    uint32_t _free_list;        // Released slot index + 1, 0 when empty
+    uint32_t _index_live;
+    uint32_t _index_tombstones;
+    uint32_t _strings_used;
+    uint32_t _clock_hand;        // Next slot the eviction sweep looks at
+    _Atomic uint64_t _hits;      // Lookups served by a slot already in the table
+    _Atomic uint64_t _misses;    // Lookups that started a download
+    _Atomic uint64_t _evictions; // Completed slots recycled to make room
+    download_index_entry_t _index[DOWNLOAD_INDEX_SIZE];
+    download_slot_t _slots[MAX_DOWNLOADS];
+    char _strings[STRING_TABLE_SIZE];
+    data_arena_t _arena;
+} download_table_t;
+
+static inline uint64_t download_name_hash(const char* name)
+{
+    uint64_t hash = 0xcbf29ce484222325ull; // FNV-1a
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++)
+    {
+        hash ^= *p;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief Empties the table. Only the header and the index are cleared: slots
+ * and strings are initialized when they are handed out.
+ */
+static inline void download_table_init(download_table_t* table)
+{
+    atomic_store_explicit(&table->_slots_used, 0, memory_order_relaxed);
+    table->_free_list = 0;
+    table->_index_live = 0;
+    table->_index_tombstones = 0;
+    table->_strings_used = 0;
+    table->_clock_hand = 0;
+    atomic_store_explicit(&table->_hits, 0, memory_order_relaxed);
+    atomic_store_explicit(&table->_misses, 0, memory_order_relaxed);
+    atomic_store_explicit(&table->_evictions, 0, memory_order_relaxed);
+    memset(table->_index, 0, sizeof(table->_index));
+    data_arena_init(&table->_arena);
+}
+
+static inline const char* download_table_name(const download_table_t* table, const download_slot_t* slot)
+{
+    return table->_strings + atomic_load_explicit(&slot->_name_offset, memory_order_relaxed);
+}
+
+// --- Sequence lock ---
+
+/**
+ * @brief Starts an update of the slot's (seq) fields. Makes _seq odd, even
+ * if a writer died halfway and left it odd.
+ */
+static inline void slot_write_begin(download_slot_t* slot)
+{
+    uint32_t seq = atomic_load_explicit(&slot->_seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->_seq, (seq + 1) | 1, memory_order_relaxed);
+    // The odd value must be visible before any field changes.
+    atomic_thread_fence(memory_order_release);
+}
+
+/**
+ * @brief Publishes the update and wakes every process waiting on the slot.
+ */
+static inline void slot_write_end(download_slot_t* slot)
+{
+    uint32_t seq = atomic_load_explicit(&slot->_seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->_seq, seq + 1, memory_order_release);
+    futex_wake(&slot->_seq, INT_MAX);
+}
+
+#define SLOT_READ_MAX_TRIES 1000 // Beyond this the writer is likely preempted or dead
+
+/**
+ * @brief Copies the slot's (seq) fields without taking any lock or writing
+ * to the slot. Returns the number of retries it took, or -1 if no consistent
+ * copy could be had (a writer stalled mid-update); callers then fall back to
+ * the locked path.
+ */
+static inline int slot_read(download_slot_t* slot, download_snapshot_t* snap)
+{
+    for (int tries = 0; tries < SLOT_READ_MAX_TRIES; tries++)
+    {
+        uint32_t seq = atomic_load_explicit(&slot->_seq, memory_order_acquire);
+        if (seq & 1)
+        {
+            if (tries >= 64)
+                sched_yield(); // Let a preempted writer finish
+            continue;
+        }
+        snap->_status = atomic_load_explicit(&slot->_status, memory_order_relaxed);
+        snap->_downloader_pid = atomic_load_explicit(&slot->_downloader_pid, memory_order_relaxed);
+        snap->_name_hash = atomic_load_explicit(&slot->_name_hash, memory_order_relaxed);
+        snap->_name_offset = atomic_load_explicit(&slot->_name_offset, memory_order_relaxed);
+        snap->_bytes_downloaded = atomic_load_explicit(&slot->_bytes_downloaded, memory_order_relaxed);
+        snap->_total_bytes = atomic_load_explicit(&slot->_total_bytes, memory_order_relaxed);
+        snap->_completed_ns = atomic_load_explicit(&slot->_completed_ns, memory_order_relaxed);
+        snap->_data_offset = atomic_load_explicit(&slot->_data_offset, memory_order_relaxed);
+        snap->_data_capacity = atomic_load_explicit(&slot->_data_capacity, memory_order_relaxed);
+        // The copies above must complete before _seq is checked again.
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->_seq, memory_order_relaxed) == seq)
+        {
+            snap->_seq = seq;
+            return tries;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Marks a freshly inserted slot as being downloaded by pid into the
+ * arena run from data_arena_alloc(), which the slot now owns. Called with the
+ * table's lock held, right after download_table_insert().
+ */
+static inline void slot_publish_claim(download_slot_t* slot, pid_t pid, long total_bytes, uint64_t data_offset,
+                                      uint64_t data_capacity)
+{
+    slot_write_begin(slot);
+    atomic_store_explicit(&slot->_data_offset, data_offset, memory_order_relaxed);
+    atomic_store_explicit(&slot->_data_capacity, data_capacity, memory_order_relaxed);
+    atomic_store_explicit(&slot->_downloader_pid, pid, memory_order_relaxed);
+    atomic_store_explicit(&slot->_total_bytes, total_bytes, memory_order_relaxed);
+    atomic_store_explicit(&slot->_bytes_downloaded, 0, memory_order_relaxed);
+    atomic_store_explicit(&slot->_status, STATUS_IN_PROGRESS, memory_order_relaxed);
+    slot_write_end(slot);
+}
+
+/**
+ * @brief Publishes download progress. Only the claiming downloader calls it,
+ * and it needs no lock.
+ */
+static inline void slot_publish_progress(download_slot_t* slot, long bytes_downloaded)
+{
+    slot_write_begin(slot);
+    atomic_store_explicit(&slot->_bytes_downloaded, bytes_downloaded, memory_order_relaxed);
+    slot_write_end(slot);
+}
+
+/**
+ * @brief Marks the download complete. Called with the table's lock held.
+ */
+static inline void slot_publish_complete(download_slot_t* slot, uint64_t completed_ns)
+{
+    slot_write_begin(slot);
+    atomic_store_explicit(&slot->_completed_ns, completed_ns, memory_order_relaxed);
+    atomic_store_explicit(&slot->_status, STATUS_COMPLETED, memory_order_relaxed);
+    slot_write_end(slot);
+}
+
+/**
+ * @brief Returns the slot index for name, or -1 if it is not in the table.
+ */
+static inline int download_table_find(const download_table_t* table, const char* name)
+{
+    uint64_t hash = download_name_hash(name);
+    for (uint32_t i = hash & (DOWNLOAD_INDEX_SIZE - 1);; i = (i + 1) & (DOWNLOAD_INDEX_SIZE - 1))
+    {
+        const download_index_entry_t* entry = &table->_index[i];
+        if (entry->_slot == INDEX_EMPTY)
+            return -1;
+        if (entry->_slot != INDEX_TOMBSTONE && entry->_hash == hash)
+        {
+            const download_slot_t* slot = &table->_slots[entry->_slot - 1];
+            if (strcmp(download_table_name(table, slot), name) == 0)
+                return entry->_slot - 1;
+        }
+    }
+}
+
+static inline void download_index_put(download_table_t* table, uint64_t hash, uint32_t slot_index)
+{
+    uint32_t i = hash & (DOWNLOAD_INDEX_SIZE - 1);
+    while (table->_index[i]._slot != INDEX_EMPTY && table->_index[i]._slot != INDEX_TOMBSTONE)
+        i = (i + 1) & (DOWNLOAD_INDEX_SIZE - 1);
+    if (table->_index[i]._slot == INDEX_TOMBSTONE)
+        table->_index_tombstones--;
+    table->_index[i]._hash = hash;
+    table->_index[i]._slot = slot_index + 1;
+    table->_index_live++;
+}
+
+/**
+ * @brief Re-inserts every live slot into a cleared index, dropping tombstones.
+ */
+static inline void download_index_rebuild(download_table_t* table)
+{
+    memset(table->_index, 0, sizeof(table->_index));
+    table->_index_live = 0;
+    table->_index_tombstones = 0;
+    for (uint32_t i = 0; i < table->_slots_used; i++)
+        if (table->_slots[i]._status != STATUS_EMPTY)
+            download_index_put(table, table->_slots[i]._name_hash, i);
+}
+
+/**
+ * @brief Releases a slot: drops it from the index, frees its arena run and
+ * puts it on the free list. Its name stays in the string table until the
+ * next compaction.
+ */
+static inline void download_table_remove(download_table_t* table, int slot_index)
+{
+    download_slot_t* slot = &table->_slots[slot_index];
+    for (uint32_t i = slot->_name_hash & (DOWNLOAD_INDEX_SIZE - 1);; i = (i + 1) & (DOWNLOAD_INDEX_SIZE - 1))
+    {
+        if (table->_index[i]._slot == (uint32_t)slot_index + 1)
+        {
+            table->_index[i]._slot = INDEX_TOMBSTONE;
+            table->_index_live--;
+            table->_index_tombstones++;
+            break;
+        }
+    }
+    uint64_t capacity = atomic_load_explicit(&slot->_data_capacity, memory_order_relaxed);
+    if (capacity != 0)
+        data_arena_free(&table->_arena, atomic_load_explicit(&slot->_data_offset, memory_order_relaxed), capacity);
+    slot_write_begin(slot);
+    atomic_store_explicit(&slot->_status, STATUS_EMPTY, memory_order_relaxed);
+    atomic_store_explicit(&slot->_data_capacity, 0, memory_order_relaxed);
+    slot_write_end(slot);
+    atomic_store_explicit(&slot->_refs, 0, memory_order_relaxed);
+    slot->_next_free = table->_free_list;
+    table->_free_list = slot_index + 1;
+}
+
+/**
+ * @brief Squeezes the names of released slots out of the string table. Walks
+ * the names in order and moves each live one down, so nothing is overwritten
+ * before it is moved; a name is live if the index maps it to a slot whose
+ * offset is this one. Monitors printing a name meanwhile may see it torn.
+ */
+static inline void download_strings_compact(download_table_t* table)
+{
+    uint32_t kept = 0;
+    for (uint32_t offset = 0; offset < table->_strings_used;)
+    {
+        const char* name = table->_strings + offset;
+        uint32_t length = strnlen(name, table->_strings_used - offset) + 1;
+        int slot_index = download_table_find(table, name);
+        if (slot_index != -1 && table->_slots[slot_index]._name_offset == offset)
+        {
+            memmove(table->_strings + kept, name, length);
+            // One store, outside the seqlock: a downloading slot's owner may be
+            // publishing progress right now, and each slot has one writer.
+            // Lock-free readers match on _name_hash, not on the offset.
+            atomic_store_explicit(&table->_slots[slot_index]._name_offset, kept, memory_order_release);
+            kept += length;
+        }
+        offset += length;
+    }
+    table->_strings_used = kept;
+}
+
+/**
+ * @brief Recycles one completed slot nobody is using, chosen by CLOCK, and
+ * frees its arena run. Returns the slot index, or -1 if every slot is in use
+ * or still downloading.
+ */
+static inline int download_table_evict(download_table_t* table)
+{
+    uint32_t used = table->_slots_used;
+    // Two turns: the first may only clear _referenced bits
+    for (uint32_t step = 0; step < 2 * used; step++)
+    {
+        uint32_t i = table->_clock_hand < used ? table->_clock_hand : 0;
+        table->_clock_hand = i + 1;
+        download_slot_t* slot = &table->_slots[i];
+        if (slot->_status != STATUS_COMPLETED || atomic_load_explicit(&slot->_refs, memory_order_relaxed) != 0)
+            continue;
+        if (slot->_referenced)
+        {
+            slot->_referenced = 0;
+            continue;
+        }
+        download_table_remove(table, i);
+        atomic_fetch_add_explicit(&table->_evictions, 1, memory_order_relaxed);
+        return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Claims a slot for name, which must not be in the table yet, and
+ * counts a miss. The slot is returned as STATUS_EMPTY with its name set and
+ * one reference, the caller's; the caller fills in the rest and sets the
+ * status. A full table first compacts its names and evicts unused slots.
+ * Returns -1 if everything left is in use.
+ */
+static inline int download_table_insert(download_table_t* table, const char* name)
+{
+    size_t length = strlen(name) + 1;
+    if (length > FILE_NAME_SIZE)
+        return -1;
+    if (table->_strings_used + length > STRING_TABLE_SIZE)
+    {
+        // Evict names too if dropping the released ones leaves little room,
+        // so the next inserts do not compact again.
+        download_strings_compact(table);
+        size_t room = STRING_TABLE_SIZE - table->_strings_used;
+        int evicted;
+        while (room < STRING_TABLE_SLACK && (evicted = download_table_evict(table)) != -1)
+            room += strlen(download_table_name(table, &table->_slots[evicted])) + 1;
+        if (room != STRING_TABLE_SIZE - table->_strings_used)
+            download_strings_compact(table);
+        if (table->_strings_used + length > STRING_TABLE_SIZE)
+            return -1;
+    }
+
+    if (table->_free_list == 0 && table->_slots_used == MAX_DOWNLOADS && download_table_evict(table) < 0)
+        return -1;
+    uint32_t slot_index;
+    if (table->_free_list != 0)
+    {
+        slot_index = table->_free_list - 1;
+        table->_free_list = table->_slots[slot_index]._next_free;
+    }
+    else
+        slot_index = atomic_fetch_add_explicit(&table->_slots_used, 1, memory_order_release);
+
+    // Probe sequences only end at empty entries; keep enough of them around.
+    if (table->_index_live + table->_index_tombstones + 1 > DOWNLOAD_INDEX_SIZE * 3 / 4)
+        download_index_rebuild(table);
+
+    // The name is in place before a reader can see the offset pointing at it.
+    uint64_t hash = download_name_hash(name);
+    memcpy(table->_strings + table->_strings_used, name, length);
+    download_slot_t* slot = &table->_slots[slot_index];
+    slot_write_begin(slot);
+    atomic_store_explicit(&slot->_status, STATUS_EMPTY, memory_order_relaxed);
+    atomic_store_explicit(&slot->_name_hash, hash, memory_order_relaxed);
+    atomic_store_explicit(&slot->_name_offset, table->_strings_used, memory_order_relaxed);
+    atomic_store_explicit(&slot->_data_capacity, 0, memory_order_relaxed);
+    slot_write_end(slot);
+    table->_strings_used += length;
+    atomic_store_explicit(&slot->_refs, 1, memory_order_relaxed);
+    slot->_referenced = 1;
+    atomic_fetch_add_explicit(&table->_misses, 1, memory_order_relaxed);
+
+    download_index_put(table, hash, slot_index);
+    return slot_index;
+}
+
+/**
+ * @brief Reserves arena room for a slot's content, evicting unused slots
+ * until it fits. Stores the run like data_arena_alloc() and returns 0, or -1
+ * if not enough can be freed.
+ */
+static inline int download_table_reserve_data(download_table_t* table, uint64_t bytes, uint64_t* offset,
+                                              uint64_t* capacity)
+{
+    while (data_arena_alloc(&table->_arena, bytes, offset, capacity) == -1)
+        if (download_table_evict(table) < 0)
+            return -1;
+    return 0;
+}
+
+/**
+ * @brief Takes a reference on a completed slot found by a lookup, so it is not
+ * evicted while its content is in use, and counts a hit.
+ */
+static inline void download_table_acquire(download_table_t* table, int slot_index)
+{
+    download_slot_t* slot = &table->_slots[slot_index];
+    atomic_fetch_add_explicit(&slot->_refs, 1, memory_order_relaxed);
+    slot->_referenced = 1;
+    atomic_fetch_add_explicit(&table->_hits, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Drops a reference from download_table_insert() or
+ * download_table_acquire() once the content is no longer in use.
+ */
+static inline void download_table_release(download_table_t* table, int slot_index)
+{
+    download_slot_t* slot = &table->_slots[slot_index];
+    if (atomic_load_explicit(&slot->_refs, memory_order_relaxed) != 0)
+        atomic_fetch_sub_explicit(&slot->_refs, 1, memory_order_relaxed);
+}
+
+
+/**
+ * @brief Frees the slots of downloads nobody is running any more and drops
+ * the references of processes that are gone. For a persistent table
+ * reattached with no other process alive, every STATUS_IN_PROGRESS slot and
+ * every reference is such a leftover.
+ * Returns the number of slots freed.
+ */
+static inline uint32_t download_table_reset_in_progress(download_table_t* table)
+{
+    uint32_t reset = 0;
+    for (uint32_t i = 0; i < table->_slots_used; i++)
+    {
+        atomic_store_explicit(&table->_slots[i]._refs, 0, memory_order_relaxed);
+        if (table->_slots[i]._status == STATUS_IN_PROGRESS)
+        {
+            download_table_remove(table, i);
+            reset++;
+        }
+    }
+    return reset;
+}
+
+/**
+ * @brief Rebuilds everything derivable from the slots after a crash: a
+ * process that died mid-update may have left the index, the free list or a
+ * slot's sequence half-written. Unfinished downloads are dropped; completed
+ * ones keep their content, and the arena's free lists are rebuilt around it.
+ * A compaction cut short may have moved a name from under its slot, so each
+ * kept slot's name is checked against its hash. References are dropped: no
+ * other process is attached. Returns the number of slots freed.
+ */
+static inline uint32_t download_table_recover(download_table_t* table)
+{
+    uint32_t used = table->_slots_used;
+    if (used > MAX_DOWNLOADS)
+        used = MAX_DOWNLOADS;
+    atomic_store_explicit(&table->_slots_used, used, memory_order_relaxed);
+    if (table->_strings_used > STRING_TABLE_SIZE)
+        table->_strings_used = STRING_TABLE_SIZE;
+
+    uint32_t reset = 0;
+    table->_free_list = 0;
+    table->_clock_hand = 0;
+    data_arena_init(&table->_arena);
+    for (uint32_t i = used; i-- > 0;)
+    {
+        download_slot_t* slot = &table->_slots[i];
+        download_status_t status = slot->_status;
+        atomic_store_explicit(&slot->_refs, 0, memory_order_relaxed);
+        const char* name = table->_strings + slot->_name_offset;
+        if (status == STATUS_COMPLETED && slot->_name_offset < table->_strings_used
+            && strnlen(name, table->_strings_used - slot->_name_offset) < table->_strings_used - slot->_name_offset
+            && download_name_hash(name) == slot->_name_hash
+            && (slot->_data_capacity == 0 || data_arena_mark(&table->_arena, slot->_data_offset, slot->_data_capacity) == 0))
+        {
+            if (atomic_load_explicit(&slot->_seq, memory_order_relaxed) & 1)
+            {
+                slot_write_begin(slot); // Evens out a sequence left odd
+                slot_write_end(slot);
+            }
+            continue;
+        }
+        reset += status != STATUS_EMPTY;
+        slot_write_begin(slot);
+        atomic_store_explicit(&slot->_status, STATUS_EMPTY, memory_order_relaxed);
+        atomic_store_explicit(&slot->_data_capacity, 0, memory_order_relaxed);
+        slot_write_end(slot);
+        slot->_next_free = table->_free_list;
+        table->_free_list = i + 1;
+    }
+    data_arena_collect_holes(&table->_arena);
+    download_index_rebuild(table);
+    return reset;
+}
+
+/**
+ * @brief Sleeps until the slot changes. Pass the _seq of a snapshot: an update
+ * made since then has already changed _seq, so the futex returns at once
+ * instead of missing the wake-up.
+ */
+static inline void slot_wait(download_slot_t* slot, uint32_t seq)
+{
+    // A downloader that dies never notifies; re-check now and then anyway.
+    const struct timespec timeout = { 5, 0 };
+    futex_wait(&slot->_seq, seq, &timeout);
+}
+
+#endif // DOWNLOAD_TABLE_H
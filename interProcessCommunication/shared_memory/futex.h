@@ -0,0 +1,34 @@
+#ifndef SHM_FUTEX_H
+#define SHM_FUTEX_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Thin wrappers around the futex(2) syscall for words that live in shared memory.
+// The non-PRIVATE operations are used on purpose: the kernel then keys the wait
+// queue by the physical page, so processes that mapped the segment at different
+// addresses still meet on the same futex.
+
+/**
+ * @brief Sleeps while *addr == expected, or until woken or the timeout expires.
+ * Returns 0 when woken, -1 with errno EAGAIN if *addr had already changed,
+ * ETIMEDOUT on timeout or EINTR on a signal. Callers re-check their condition.
+ */
+static inline int futex_wait(_Atomic uint32_t* addr, uint32_t expected, const struct timespec* timeout)
+{
+    return (int)syscall(SYS_futex, (uint32_t*)addr, FUTEX_WAIT, expected, timeout, NULL, 0);
+}
+
+/**
+ * @brief Wakes up to count waiters sleeping on addr. Returns how many were woken.
+ */
+static inline int futex_wake(_Atomic uint32_t* addr, int count)
+{
+    return (int)syscall(SYS_futex, (uint32_t*)addr, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+#endif // SHM_FUTEX_H
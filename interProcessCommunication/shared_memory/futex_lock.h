@@ -0,0 +1,150 @@
+#ifndef SHM_FUTEX_LOCK_H
+#define SHM_FUTEX_LOCK_H
+
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "futex.h"
+
+// Process-shared lock on a single 32-bit futex word, for structures that live
+// in shared memory. The word holds 0 when free, otherwise the owner's pid with
+// FUTEX_LOCK_WAITERS set once somebody went to sleep on it:
+//
+//   - lock/unlock with nobody else around is one atomic each, no syscall
+//     (a pthread mutex is similar; a SysV semop is always a syscall);
+//   - a contended locker spins briefly, then sleeps in the kernel;
+//   - unlock only calls futex_wake() when the waiters bit is set;
+//   - a sleeper re-checks the owner every FUTEX_LOCK_CHECK_MS, and if that
+//     process is gone it takes the lock over and reports it to the caller.
+//
+// An all-zero word is an unlocked lock, so a freshly created segment needs no
+// initialization. Ownership is per process: threads of one process exclude
+// each other too, but owner recovery only notices whole processes dying.
+// Like any pid-based scheme, a recycled pid can hide a dead owner.
+
+#define FUTEX_LOCK_WAITERS 0x80000000u
+#define FUTEX_LOCK_SPIN 100
+#define FUTEX_LOCK_CHECK_MS 100
+
+// futex_lock_acquire() result when the previous owner died holding the lock.
+// The caller owns the lock, but the data it protects may be half updated.
+#define FUTEX_LOCK_OWNER_DIED 1
+
+typedef struct
+{
+    _Atomic uint32_t _word;
+} futex_lock_t;
+
+// getpid() is a real syscall in current glibc; cache it so the uncontended
+// path stays a single atomic. A forked child must not keep the parent's pid.
+static pid_t futex_lock_pid;
+
+static void futex_lock_forget_pid(void)
+{
+    futex_lock_pid = 0;
+}
+
+static inline uint32_t futex_lock_self(void)
+{
+    if (futex_lock_pid == 0)
+    {
+        static int atfork_registered;
+        if (!atfork_registered)
+        {
+            atfork_registered = 1;
+            pthread_atfork(NULL, NULL, futex_lock_forget_pid);
+        }
+        futex_lock_pid = getpid();
+    }
+    return (uint32_t)futex_lock_pid;
+}
+
+static inline void futex_lock_init(futex_lock_t* lock)
+{
+    atomic_store_explicit(&lock->_word, 0, memory_order_relaxed);
+}
+
+static inline int futex_lock_owner_alive(uint32_t owner)
+{
+    return kill((pid_t)owner, 0) == 0 || errno != ESRCH;
+}
+
+/**
+ * @brief Takes the lock. Returns 0, or FUTEX_LOCK_OWNER_DIED if the lock was
+ * taken over from a process that exited while holding it.
+ */
+static inline int futex_lock_acquire(futex_lock_t* lock)
+{
+    uint32_t self = futex_lock_self();
+    uint32_t word = 0;
+    if (atomic_compare_exchange_strong_explicit(&lock->_word, &word, self,
+                                                memory_order_acquire, memory_order_relaxed))
+        return 0;
+
+    // Short critical sections are often over before a sleep would even start.
+    for (int i = 0; i < FUTEX_LOCK_SPIN; i++)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+        word = atomic_load_explicit(&lock->_word, memory_order_relaxed);
+        if (word == 0
+            && atomic_compare_exchange_weak_explicit(&lock->_word, &word, self,
+                                                     memory_order_acquire, memory_order_relaxed))
+            return 0;
+    }
+
+    // Slow path. Once we have slept we cannot know whether others are still
+    // asleep, so from here the lock is always taken with the waiters bit set.
+    const struct timespec check = { 0, FUTEX_LOCK_CHECK_MS * 1000000L };
+    for (;;)
+    {
+        word = atomic_load_explicit(&lock->_word, memory_order_relaxed);
+        if (word == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&lock->_word, &word, self | FUTEX_LOCK_WAITERS,
+                                                      memory_order_acquire, memory_order_relaxed))
+                return 0;
+            continue;
+        }
+
+        if (!futex_lock_owner_alive(word & ~FUTEX_LOCK_WAITERS))
+        {
+            if (atomic_compare_exchange_strong_explicit(&lock->_word, &word, self | FUTEX_LOCK_WAITERS,
+                                                        memory_order_acquire, memory_order_relaxed))
+                return FUTEX_LOCK_OWNER_DIED;
+            continue;
+        }
+
+        if (!(word & FUTEX_LOCK_WAITERS)
+            && !atomic_compare_exchange_weak_explicit(&lock->_word, &word, word | FUTEX_LOCK_WAITERS,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            continue;
+
+        futex_wait(&lock->_word, word | FUTEX_LOCK_WAITERS, &check);
+    }
+}
+
+/**
+ * @brief Takes the lock only if it is free. Returns 1 on success.
+ */
+static inline int futex_lock_try_acquire(futex_lock_t* lock)
+{
+    uint32_t word = 0;
+    return atomic_compare_exchange_strong_explicit(&lock->_word, &word, futex_lock_self(),
+                                                   memory_order_acquire, memory_order_relaxed);
+}
+
+static inline void futex_lock_release(futex_lock_t* lock)
+{
+    uint32_t word = atomic_exchange_explicit(&lock->_word, 0, memory_order_release);
+    if (word & FUTEX_LOCK_WAITERS)
+        futex_wake(&lock->_word, 1);
+}
+
+#endif // SHM_FUTEX_LOCK_H
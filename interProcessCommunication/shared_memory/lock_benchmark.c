@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+#include <sys/wait.h>
+
+#include "futex_lock.h"
+#include "../bench_common.h"
+
+// Cost of one lock/unlock pair for the three process-shared locks used by the
+// downloader clients: a pthread mutex in shared memory, a SysV semaphore with
+// SEM_UNDO, and the futex lock from futex_lock.h. Each lock is measured with
+// one process (uncontended) and with several processes incrementing a shared
+// counter.
+//
+// Usage: ./lock_benchmark [processes] [iterations]
+// Build: gcc lock_benchmark.c -o lock_benchmark -pthread
+
+typedef struct
+{
+    pthread_mutex_t _mutex;
+    futex_lock_t _futex_lock;
+    long _counter;
+} bench_data_t;
+
+typedef enum
+{
+    LOCK_PTHREAD_MUTEX = 0,
+    LOCK_SEMOP,
+    LOCK_FUTEX,
+    LOCK_COUNT
+} lock_kind_t;
+
+static const char* lock_names[LOCK_COUNT] = { "pthread_mutex", "semop", "futex_lock" };
+
+static bench_data_t* data;
+static int semid;
+
+static void lock_kind(lock_kind_t kind)
+{
+    static struct sembuf pop = { 0, -1, SEM_UNDO };
+    switch (kind)
+    {
+    case LOCK_PTHREAD_MUTEX: pthread_mutex_lock(&data->_mutex); break;
+    case LOCK_SEMOP: semop(semid, &pop, 1); break;
+    case LOCK_FUTEX: futex_lock_acquire(&data->_futex_lock); break;
+    default: break;
+    }
+}
+
+static void unlock_kind(lock_kind_t kind)
+{
+    static struct sembuf vop = { 0, 1, SEM_UNDO };
+    switch (kind)
+    {
+    case LOCK_PTHREAD_MUTEX: pthread_mutex_unlock(&data->_mutex); break;
+    case LOCK_SEMOP: semop(semid, &vop, 1); break;
+    case LOCK_FUTEX: futex_lock_release(&data->_futex_lock); break;
+    default: break;
+    }
+}
+
+/**
+ * @brief Runs `processes` children that each take the lock `iterations` times.
+ * Returns the wall time per lock/unlock pair in nanoseconds.
+ */
+static double run(lock_kind_t kind, int processes, long iterations)
+{
+    data->_counter = 0;
+    uint64_t start = now_ns();
+
+    for (int p = 0; p < processes; p++)
+    {
+        pid_t pid = fork();
+        if (pid == -1)
+        {
+            perror("fork");
+            exit(1);
+        }
+        if (pid == 0)
+        {
+            for (long i = 0; i < iterations; i++)
+            {
+                lock_kind(kind);
+                data->_counter++;
+                unlock_kind(kind);
+            }
+            _exit(0);
+        }
+    }
+    while (wait(NULL) > 0)
+        ;
+
+    uint64_t elapsed = now_ns() - start;
+    if (data->_counter != processes * iterations)
+        fprintf(stderr, "%s: counter is %ld, expected %ld\n", lock_names[kind], data->_counter, processes * iterations);
+    return (double)elapsed / ((double)processes * iterations);
+}
+
+int main(int argc, char* argv[])
+{
+    int processes = argc > 1 ? atoi(argv[1]) : 4;
+    long iterations = argc > 2 ? atol(argv[2]) : 1000000;
+
+    data = mmap(NULL, sizeof(bench_data_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+    {
+        perror("mmap");
+        exit(1);
+    }
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&data->_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    futex_lock_init(&data->_futex_lock);
+
+    semid = semget(IPC_PRIVATE, 1, 0600);
+    if (semid == -1 || semctl(semid, 0, SETVAL, 1) == -1)
+    {
+        perror("semget");
+        exit(1);
+    }
+
+    printf("%-14s %18s %18s\n", "lock", "1 process ns/op", "contended ns/op");
+    for (lock_kind_t kind = 0; kind < LOCK_COUNT; kind++)
+    {
+        double uncontended = run(kind, 1, iterations);
+        double contended = run(kind, processes, iterations);
+        printf("%-14s %18.1f %18.1f\n", lock_names[kind], uncontended, contended);
+    }
+
+    semctl(semid, 0, IPC_RMID);
+    munmap(data, sizeof(bench_data_t));
+    return 0;
+}
@@ -3,36 +3,73 @@
 
 #include <sys/types.h>
 #include <sys/ipc.h>
+#include <errno.h>
 #include <pthread.h>
 
+#include "../download_table.h"
+
 // Define a key for ftok() to find the shared memory
 #define KEY_PATH "downloader_key_file"
 #define KEY_ID 'M'
+#define DATA_KEY_ID 'm' // The data arena's segment
+
+// The lock guarding the slot table. By default a robust process-shared
+// pthread mutex; build with -DUSE_FUTEX_LOCK for the futex lock in
+// ../futex_lock.h. Either way shared_lock() returns SHARED_LOCK_OWNER_DIED
+// when the previous holder exited while holding it.
+#ifdef USE_FUTEX_LOCK
+#include "../futex_lock.h"
+
+typedef futex_lock_t shared_lock_t;
+#define SHARED_LOCK_OWNER_DIED FUTEX_LOCK_OWNER_DIED
+
+static inline void shared_lock_init(shared_lock_t* lock)
+{
+    futex_lock_init(lock);
+}
+
+static inline int shared_lock(shared_lock_t* lock)
+{
+    return futex_lock_acquire(lock);
+}
+
+static inline void shared_unlock(shared_lock_t* lock)
+{
+    futex_lock_release(lock);
+}
+#else
+typedef pthread_mutex_t shared_lock_t;
+#define SHARED_LOCK_OWNER_DIED EOWNERDEAD
 
-#define MAX_DOWNLOADS 10
+static inline void shared_lock_init(shared_lock_t* lock)
+{
+    // Initialize mutex attributes for process-sharing
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static inline int shared_lock(shared_lock_t* lock)
+{
+    int rc = pthread_mutex_lock(lock);
+    if (rc == EOWNERDEAD)
+        pthread_mutex_consistent(lock);
+    return rc;
+}
 
-typedef enum
+static inline void shared_unlock(shared_lock_t* lock)
 {
-    STATUS_EMPTY = 0,
-    STATUS_IN_PROGRESS,
-    STATUS_COMPLETED
-} download_status_t;
-
-#define FILE_NAME_SIZE 256
-
-// The structure that will be placed in shared memory
-typedef struct {
-    download_status_t _status;
-    pid_t _downloader_pid;
-    char _file_name[FILE_NAME_SIZE];
-    long _bytes_downloaded;
-    long _total_bytes;
-} download_slot_t;
+    pthread_mutex_unlock(lock);
+}
+#endif
 
 typedef struct 
 {
-    pthread_mutex_t _mutex;
-    download_slot_t _slots[MAX_DOWNLOADS];
+    shared_lock_t _lock;
+    download_table_t _table;
 } shared_data_t;
 
 #endif // DOWNLOAD_COMMON_H
\ No newline at end of file
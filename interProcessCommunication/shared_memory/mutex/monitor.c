@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <errno.h>
+
+#include "common.h"
+#include "../persistent_segment.h"
+#include "../../bench_common.h"
+
+// Compile with:
+// gcc -O2 monitor.c -o monitor -pthread
+//
+// Usage (from the directory the downloaders run in):
+//   ./monitor [-p cache_file] [interval_ms [rounds]]
+//
+// A dashboard for the download table. It attaches the segment read-only
+// (SHM_RDONLY) and reads every slot through its sequence lock, so it never
+// takes the table's lock and never writes a byte the downloaders use: any
+// number of monitors can poll as often as they like without slowing the
+// downloads down. Each round prints the active slots with the arena memory
+// and references each one holds, how long the scan took and the cache's hit,
+// miss and eviction counters. rounds 0 (the default) runs
+// until interrupted. With -p it watches the table the downloaders keep in
+// cache_file instead, mapped PROT_READ.
+
+#define DEFAULT_INTERVAL_MS 1000
+
+static const char* status_name(download_status_t status)
+{
+    return status == STATUS_IN_PROGRESS ? "downloading" : status == STATUS_COMPLETED ? "completed" : "empty";
+}
+
+int main(int argc, char* argv[])
+{
+    const char* persist_path = NULL;
+    int opt, bad_args = 0;
+    while ((opt = getopt(argc, argv, "p:")) != -1)
+    {
+        if (opt == 'p')
+            persist_path = optarg;
+        else
+            bad_args = 1;
+    }
+    argc -= optind;
+    argv += optind;
+    long interval_ms = (argc >= 1) ? atol(argv[0]) : DEFAULT_INTERVAL_MS;
+    long rounds = (argc >= 2) ? atol(argv[1]) : 0;
+    if (bad_args || argc > 2 || interval_ms < 0 || rounds < 0)
+    {
+        fprintf(stderr, "usage: monitor [-p cache_file] [interval_ms [rounds]]\n");
+        return 1;
+    }
+
+    const shared_data_t* shared_data;
+    persistent_segment_t segment = { ._fd = -1 };
+    if (persist_path)
+    {
+        if (persistent_segment_map_readonly(&segment, persist_path, sizeof(shared_data_t), DOWNLOAD_TABLE_VERSION, KEY_ID) == -1)
+            return 1;
+        shared_data = segment._data;
+    }
+    else
+    {
+        key_t key = ftok(KEY_PATH, KEY_ID);
+        if (key == -1)
+        {
+            perror("ftok (has a downloader run in this directory?)");
+            return 1;
+        }
+        int shmid = shmget(key, 0, 0);
+        if (shmid == -1)
+        {
+            perror("shmget");
+            return 1;
+        }
+        shared_data = shmat(shmid, NULL, SHM_RDONLY);
+        if (shared_data == (void*)-1)
+        {
+            perror("shmat");
+            return 1;
+        }
+    }
+    // Readers only load from the slots; the cast just drops const for the atomics.
+    download_table_t* table = (download_table_t*)&shared_data->_table;
+
+    for (long round = 0; rounds == 0 || round < rounds; round++)
+    {
+        uint64_t start = now_ns();
+        uint32_t used = atomic_load_explicit(&table->_slots_used, memory_order_acquire);
+        uint32_t active = 0, completed = 0, retries = 0, stalled = 0;
+
+        printf("%6s  %-11s %8s %5s %7s %4s  %s\n", "slot", "status", "pid", "done", "mem", "refs", "name");
+        for (uint32_t i = 0; i < used; i++)
+        {
+            download_snapshot_t snap;
+            int tries = slot_read(&table->_slots[i], &snap);
+            if (tries < 0)
+            {
+                stalled++;
+                continue;
+            }
+            retries += tries;
+            if (snap._status == STATUS_EMPTY)
+                continue;
+            if (snap._status == STATUS_COMPLETED)
+                completed++;
+            else
+                active++;
+            long percent = snap._total_bytes > 0 ? snap._bytes_downloaded * 100 / snap._total_bytes : 0;
+            printf("%6u  %-11s %8d %4ld%% %5luMB %4u  %.*s\n", i, status_name(snap._status), snap._downloader_pid, percent,
+                   (unsigned long)(snap._data_capacity >> 20), atomic_load_explicit(&table->_slots[i]._refs, memory_order_relaxed),
+                   FILE_NAME_SIZE, table->_strings + snap._name_offset);
+        }
+        uint64_t elapsed = now_ns() - start;
+        uint64_t arena_bytes = atomic_load_explicit(&table->_arena._bytes_in_use, memory_order_relaxed);
+        printf("%u slots scanned in %.1f us: %u downloading, %u completed, %u retries, %u stalled writers\n",
+               used, elapsed / 1e3, active, completed, retries, stalled);
+        uint64_t hits = atomic_load_explicit(&table->_hits, memory_order_relaxed);
+        uint64_t misses = atomic_load_explicit(&table->_misses, memory_order_relaxed);
+        printf("data arena: %lu of %lu MB in use\n", (unsigned long)(arena_bytes >> 20),
+               (unsigned long)(DATA_ARENA_SIZE >> 20));
+        printf("cache: %lu hits, %lu misses (%.1f%% hit rate), %lu evictions\n\n", (unsigned long)hits,
+               (unsigned long)misses, hits + misses ? hits * 100.0 / (hits + misses) : 0.0,
+               (unsigned long)atomic_load_explicit(&table->_evictions, memory_order_relaxed));
+        fflush(stdout);
+
+        if (rounds == 0 || round + 1 < rounds)
+            usleep(interval_ms * 1000);
+    }
+
+    if (persist_path)
+        munmap(segment._header, segment._map_size);
+    else
+        shmdt(shared_data);
+    return 0;
+}
@@ -0,0 +1,230 @@
+#ifndef PERSISTENT_SEGMENT_H
+#define PERSISTENT_SEGMENT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// A shared segment that outlives its processes: a file mapped MAP_SHARED.
+// On a disk path it survives reboots; a path under /dev/shm is what
+// shm_open() would give, which survives every process exiting but not a
+// reboot. Either way the SysV cleanup no longer throws the data away.
+//
+// Layout: one page of header, then the caller's data. The header says what
+// the data is (magic, version, tag, size), so a file written by another build
+// or another client is refused rather than misread, and carries a dirty flag:
+// set while processes are attached, cleared by the last one to detach
+// cleanly. Finding it set means the previous run crashed or the host went down
+// mid-run, and the data needs repairing before use.
+//
+// Who is attached is tracked with fcntl() record locks, which the kernel drops
+// when a process dies:
+//   byte 0  held exclusively while a process attaches or detaches, so those
+//           steps never interleave
+//   byte 1  read-locked by every attached process; whoever can write-lock it
+//           is alone
+// The process that attaches alone gets _exclusive set and must initialize or
+// recover the data before persistent_segment_ready().
+
+#define PERSIST_MAGIC 0x0045484341434C44ull // "DLCACHE" in little-endian byte order
+#define PERSIST_HEADER_SIZE 4096
+
+typedef enum
+{
+    PERSIST_FRESH,  // New or unusable file: the data is zeroed, initialize it
+    PERSIST_CLEAN,  // Last run detached cleanly
+    PERSIST_DIRTY   // Last run ended while attached: repair before use
+} persist_state_t;
+
+typedef struct
+{
+    uint64_t _magic;
+    uint32_t _version;    // Layout version of the data
+    uint32_t _tag;        // Which kind of data (e.g. the client's KEY_ID)
+    uint64_t _data_size;
+    _Atomic uint32_t _dirty;
+    uint32_t _attach_count; // Times the segment was attached alone, for the log
+} persist_header_t;
+
+typedef struct
+{
+    int _fd;
+    persist_header_t* _header;
+    void* _data;
+    size_t _map_size;
+    int _exclusive;         // Nobody else attached: initialize or recover now
+    persist_state_t _state; // Meaningful when _exclusive
+} persistent_segment_t;
+
+static inline int persist_lock_byte(int fd, short type, off_t byte, int wait)
+{
+    struct flock lock = { .l_type = type, .l_whence = SEEK_SET, .l_start = byte, .l_len = 1 };
+    int rc;
+    do
+        rc = fcntl(fd, wait ? F_SETLKW : F_SETLK, &lock);
+    while (rc == -1 && errno == EINTR && wait);
+    return rc;
+}
+
+/**
+ * @brief Opens (creating if needed) and maps the segment at path for
+ * data_size bytes of data. Returns 0, or -1 with a message printed. On
+ * success the attach lock is still held: call persistent_segment_ready() once
+ * the data is usable.
+ */
+static inline int persistent_segment_open(persistent_segment_t* seg, const char* path, size_t data_size,
+                                          uint32_t version, uint32_t tag)
+{
+    seg->_fd = open(path, O_RDWR | O_CREAT, 0666);
+    if (seg->_fd == -1)
+    {
+        perror("open persistent segment");
+        return -1;
+    }
+    if (persist_lock_byte(seg->_fd, F_WRLCK, 0, 1) == -1)
+    {
+        perror("fcntl(F_SETLKW)");
+        close(seg->_fd);
+        return -1;
+    }
+    seg->_exclusive = persist_lock_byte(seg->_fd, F_WRLCK, 1, 0) == 0;
+
+    struct stat st;
+    seg->_map_size = PERSIST_HEADER_SIZE + data_size;
+    if (fstat(seg->_fd, &st) == -1 || ((size_t)st.st_size < seg->_map_size && !seg->_exclusive))
+    {
+        fprintf(stderr, "persistent segment %s is in use with a different size\n", path);
+        close(seg->_fd);
+        return -1;
+    }
+    if ((size_t)st.st_size != seg->_map_size && ftruncate(seg->_fd, seg->_map_size) == -1)
+    {
+        perror("ftruncate");
+        close(seg->_fd);
+        return -1;
+    }
+
+    void* base = mmap(NULL, seg->_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, seg->_fd, 0);
+    if (base == MAP_FAILED)
+    {
+        perror("mmap persistent segment");
+        close(seg->_fd);
+        return -1;
+    }
+    seg->_header = base;
+    seg->_data = (char*)base + PERSIST_HEADER_SIZE;
+
+    persist_header_t* h = seg->_header;
+    int valid = h->_magic == PERSIST_MAGIC && h->_version == version && h->_tag == tag && h->_data_size == data_size;
+    if (!seg->_exclusive)
+    {
+        if (!valid)
+        {
+            fprintf(stderr, "persistent segment %s is in use with another layout\n", path);
+            munmap(base, seg->_map_size);
+            close(seg->_fd);
+            return -1;
+        }
+        persist_lock_byte(seg->_fd, F_RDLCK, 1, 0);
+        return 0;
+    }
+
+    if (!valid)
+    {
+        if (h->_magic != 0)
+            fprintf(stderr, "persistent segment %s has another layout or version; starting over\n", path);
+        memset(base, 0, seg->_map_size);
+        h->_magic = PERSIST_MAGIC;
+        h->_version = version;
+        h->_tag = tag;
+        h->_data_size = data_size;
+        seg->_state = PERSIST_FRESH;
+    }
+    else
+        seg->_state = atomic_load_explicit(&h->_dirty, memory_order_relaxed) ? PERSIST_DIRTY : PERSIST_CLEAN;
+    h->_attach_count++;
+    return 0;
+}
+
+/**
+ * @brief Maps an existing segment read-only for an observer: no locks, no
+ * attach, nothing written. Returns 0, or -1 with a message printed if the file
+ * is missing or holds another layout. Release it with munmap(seg->_header,
+ * seg->_map_size).
+ */
+static inline int persistent_segment_map_readonly(persistent_segment_t* seg, const char* path, size_t data_size,
+                                                  uint32_t version, uint32_t tag)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        perror("open persistent segment");
+        return -1;
+    }
+    struct stat st;
+    seg->_map_size = PERSIST_HEADER_SIZE + data_size;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size != seg->_map_size)
+    {
+        fprintf(stderr, "persistent segment %s has another size\n", path);
+        close(fd);
+        return -1;
+    }
+    void* base = mmap(NULL, seg->_map_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file referenced
+    if (base == MAP_FAILED)
+    {
+        perror("mmap persistent segment");
+        return -1;
+    }
+    persist_header_t* h = base;
+    if (h->_magic != PERSIST_MAGIC || h->_version != version || h->_tag != tag || h->_data_size != data_size)
+    {
+        fprintf(stderr, "persistent segment %s has another layout or version\n", path);
+        munmap(base, seg->_map_size);
+        return -1;
+    }
+    seg->_fd = -1;
+    seg->_header = h;
+    seg->_data = (char*)base + PERSIST_HEADER_SIZE;
+    seg->_exclusive = 0;
+    return 0;
+}
+
+/**
+ * @brief Marks the data in use and lets other processes attach.
+ */
+static inline void persistent_segment_ready(persistent_segment_t* seg)
+{
+    if (seg->_exclusive)
+    {
+        atomic_store_explicit(&seg->_header->_dirty, 1, memory_order_relaxed);
+        msync(seg->_header, PERSIST_HEADER_SIZE, MS_SYNC); // Dirty is on disk before any data changes
+        persist_lock_byte(seg->_fd, F_RDLCK, 1, 0);
+    }
+    persist_lock_byte(seg->_fd, F_UNLCK, 0, 0);
+}
+
+/**
+ * @brief Detaches. The last process out flushes the data and clears the
+ * dirty flag.
+ */
+static inline void persistent_segment_close(persistent_segment_t* seg)
+{
+    persist_lock_byte(seg->_fd, F_WRLCK, 0, 1);
+    if (persist_lock_byte(seg->_fd, F_WRLCK, 1, 0) == 0)
+    {
+        msync(seg->_header, seg->_map_size, MS_SYNC);
+        atomic_store_explicit(&seg->_header->_dirty, 0, memory_order_relaxed);
+        msync(seg->_header, PERSIST_HEADER_SIZE, MS_SYNC);
+    }
+    munmap(seg->_header, seg->_map_size);
+    close(seg->_fd); // Drops every record lock this process holds on the file
+}
+
+#endif // PERSISTENT_SEGMENT_H
@@ -0,0 +1,310 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "../futex.h"
+
+// Single-producer/single-consumer byte ring in a POSIX shared memory segment.
+//
+// Records are variable length: a 32-bit length followed by the payload, padded
+// to 8 bytes. A record never wraps; if it does not fit before the end of the
+// buffer the producer writes a padding marker and starts it at offset 0, so the
+// consumer can always read a record in place.
+//
+// Head (producer) and tail (consumer) are free-running 64-bit byte positions on
+// separate cache lines. Each side spins briefly when the ring is empty/full,
+// then yields (which lets the other side run when both share a CPU) and finally
+// sleeps on a futex; the other side only makes the wake syscall if it sees
+// the sleeping flag, so a busy ring moves data without entering the kernel.
+
+#define SHM_RING_MAGIC 0x52494e47u   // "RING": set last, once the ring is usable
+#define SHM_RING_PADDING 0xffffffffu // Length value that means "skip to offset 0"
+#define SHM_RING_SPIN 200            // Polls before yielding the CPU
+#define SHM_RING_YIELD 16            // sched_yield() calls before going to sleep
+
+typedef struct
+{
+    _Atomic uint32_t _magic;
+    uint32_t _capacity; // Bytes in _data, a power of two
+    _Atomic uint32_t _closed; // The producer will not write again
+
+    // Producer's line
+    _Alignas(64) _Atomic uint64_t _head;
+    _Atomic uint32_t _data_seq;          // Futex the consumer sleeps on
+    _Atomic uint32_t _consumer_sleeping;
+
+    // Consumer's line
+    _Alignas(64) _Atomic uint64_t _tail;
+    _Atomic uint32_t _space_seq;         // Futex the producer sleeps on
+    _Atomic uint32_t _producer_sleeping;
+
+    _Alignas(64) char _data[];
+} shm_ring_t;
+
+static inline uint32_t shm_ring_record_size(uint32_t len)
+{
+    return (sizeof(uint32_t) + len + 7) & ~7u;
+}
+
+/**
+ * @brief Largest payload a single record may carry. Keeping records within half
+ * the ring guarantees a record plus its wrap padding always fits in an empty ring.
+ */
+static inline uint32_t shm_ring_max_record(const shm_ring_t* ring)
+{
+    return ring->_capacity / 2 - sizeof(uint32_t);
+}
+
+/**
+ * @brief Creates the segment or attaches to an existing one.
+ *
+ * Mirrors the downloader clients: an O_CREAT | O_EXCL open tells us whether we
+ * are the first process. The first one sizes and initializes the ring and then
+ * publishes _magic; everybody else waits for _magic before touching it.
+ * capacity must be a power of two. Returns NULL with errno set on failure.
+ */
+static inline shm_ring_t* shm_ring_attach(const char* name, uint32_t capacity, int* is_creator)
+{
+    if (capacity < 64 || (capacity & (capacity - 1)) != 0)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    size_t size = sizeof(shm_ring_t) + capacity;
+
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0666);
+    int is_first_process = (fd != -1);
+    if (!is_first_process)
+    {
+        if (errno != EEXIST)
+            return NULL;
+        fd = shm_open(name, O_RDWR, 0666);
+        if (fd == -1)
+            return NULL;
+
+        // The creator may not have sized the segment yet; touching pages
+        // beyond the end of the object would raise SIGBUS.
+        struct stat st;
+        while (fstat(fd, &st) == 0 && (size_t)st.st_size < size)
+            usleep(1000);
+    }
+    else if (ftruncate(fd, size) == -1)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    shm_ring_t* ring = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the segment alive
+    if (ring == MAP_FAILED)
+        return NULL;
+
+    if (is_first_process)
+    {
+        // ftruncate() zero-filled the segment; only the non-zero fields need setting.
+        ring->_capacity = capacity;
+        atomic_store_explicit(&ring->_magic, SHM_RING_MAGIC, memory_order_release);
+    }
+    else
+    {
+        while (atomic_load_explicit(&ring->_magic, memory_order_acquire) != SHM_RING_MAGIC)
+            usleep(1000);
+        if (ring->_capacity != capacity)
+        {
+            munmap(ring, size);
+            errno = EINVAL;
+            return NULL;
+        }
+    }
+
+    if (is_creator)
+        *is_creator = is_first_process;
+    return ring;
+}
+
+static inline void shm_ring_detach(shm_ring_t* ring)
+{
+    munmap(ring, sizeof(shm_ring_t) + ring->_capacity);
+}
+
+/**
+ * @brief Sleeps on *seq until the other side bumps it, unless ready() turns true
+ * after we announced ourselves. The seq_cst fence pairs with the one in
+ * shm_ring_notify(): either we see the other side's update, or it sees our flag.
+ */
+static inline void shm_ring_sleep(_Atomic uint32_t* sleeping, _Atomic uint32_t* seq,
+                                  int (*ready)(shm_ring_t*), shm_ring_t* ring)
+{
+    atomic_store_explicit(sleeping, 1, memory_order_relaxed);
+    uint32_t observed = atomic_load_explicit(seq, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!ready(ring))
+        futex_wait(seq, observed, NULL);
+    atomic_store_explicit(sleeping, 0, memory_order_relaxed);
+}
+
+static inline void shm_ring_notify(_Atomic uint32_t* sleeping, _Atomic uint32_t* seq)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(sleeping, memory_order_relaxed))
+    {
+        atomic_fetch_add_explicit(seq, 1, memory_order_relaxed);
+        futex_wake(seq, 1);
+    }
+}
+
+static inline int shm_ring_has_data(shm_ring_t* ring)
+{
+    return atomic_load_explicit(&ring->_head, memory_order_acquire) != atomic_load_explicit(&ring->_tail, memory_order_relaxed)
+        || atomic_load_explicit(&ring->_closed, memory_order_acquire);
+}
+
+/**
+ * @brief Writes one record, blocking while the ring is full.
+ * Returns 0 on success, -1 with errno EMSGSIZE if len exceeds shm_ring_max_record().
+ */
+static inline int shm_ring_write(shm_ring_t* ring, const void* buf, uint32_t len)
+{
+    if (len > shm_ring_max_record(ring))
+    {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    uint32_t capacity = ring->_capacity;
+    uint32_t total = shm_ring_record_size(len);
+    uint64_t head = atomic_load_explicit(&ring->_head, memory_order_relaxed);
+    uint32_t offset = head & (capacity - 1);
+    uint32_t pad = (offset + total > capacity) ? capacity - offset : 0;
+
+    unsigned spins = 0;
+    while (capacity - (head - atomic_load_explicit(&ring->_tail, memory_order_acquire)) < pad + total)
+    {
+        if (++spins < SHM_RING_SPIN)
+            continue;
+        if (spins < SHM_RING_SPIN + SHM_RING_YIELD)
+        {
+            sched_yield();
+            continue;
+        }
+        // Park until the consumer moves the tail at all, then re-check the space.
+        uint64_t tail = atomic_load_explicit(&ring->_tail, memory_order_relaxed);
+        atomic_store_explicit(&ring->_producer_sleeping, 1, memory_order_relaxed);
+        uint32_t observed = atomic_load_explicit(&ring->_space_seq, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load_explicit(&ring->_tail, memory_order_relaxed) == tail)
+            futex_wait(&ring->_space_seq, observed, NULL);
+        atomic_store_explicit(&ring->_producer_sleeping, 0, memory_order_relaxed);
+    }
+
+    if (pad)
+    {
+        *(uint32_t*)(ring->_data + offset) = SHM_RING_PADDING;
+        head += pad;
+        offset = 0;
+    }
+    *(uint32_t*)(ring->_data + offset) = len;
+    memcpy(ring->_data + offset + sizeof(uint32_t), buf, len);
+
+    // Release: the record must be complete before the consumer sees the new head.
+    atomic_store_explicit(&ring->_head, head + total, memory_order_release);
+    shm_ring_notify(&ring->_consumer_sleeping, &ring->_data_seq);
+    return 0;
+}
+
+/**
+ * @brief Returns a pointer to the next record in place, blocking while the ring
+ * is empty. Returns NULL at end of stream (the producer closed and everything
+ * was read). Release the record with shm_ring_consume().
+ */
+static inline const void* shm_ring_peek(shm_ring_t* ring, uint32_t* len)
+{
+    uint32_t capacity = ring->_capacity;
+    uint64_t tail = atomic_load_explicit(&ring->_tail, memory_order_relaxed);
+    unsigned spins = 0;
+
+    for (;;)
+    {
+        uint64_t head = atomic_load_explicit(&ring->_head, memory_order_acquire);
+        if (head != tail)
+        {
+            uint32_t offset = tail & (capacity - 1);
+            uint32_t record_len = *(uint32_t*)(ring->_data + offset);
+            if (record_len == SHM_RING_PADDING)
+            {
+                // Skip the unused end of the buffer; the record starts at offset 0.
+                tail += capacity - offset;
+                atomic_store_explicit(&ring->_tail, tail, memory_order_release);
+                continue;
+            }
+            *len = record_len;
+            return ring->_data + offset + sizeof(uint32_t);
+        }
+
+        if (atomic_load_explicit(&ring->_closed, memory_order_acquire)
+            && atomic_load_explicit(&ring->_head, memory_order_acquire) == tail)
+            return NULL;
+
+        if (++spins < SHM_RING_SPIN)
+            continue;
+        if (spins < SHM_RING_SPIN + SHM_RING_YIELD)
+            sched_yield();
+        else
+            shm_ring_sleep(&ring->_consumer_sleeping, &ring->_data_seq, shm_ring_has_data, ring);
+    }
+}
+
+/**
+ * @brief Releases the record returned by the last shm_ring_peek().
+ */
+static inline void shm_ring_consume(shm_ring_t* ring, uint32_t len)
+{
+    uint64_t tail = atomic_load_explicit(&ring->_tail, memory_order_relaxed);
+    // Release: we are done reading the record before the producer may overwrite it.
+    atomic_store_explicit(&ring->_tail, tail + shm_ring_record_size(len), memory_order_release);
+    shm_ring_notify(&ring->_producer_sleeping, &ring->_space_seq);
+}
+
+/**
+ * @brief Copies the next record into buf, blocking while the ring is empty.
+ * Returns the record length, 0 at end of stream, or -1 with errno EMSGSIZE
+ * if buf is too small (the record is left in the ring).
+ */
+static inline ssize_t shm_ring_read(shm_ring_t* ring, void* buf, size_t size)
+{
+    uint32_t len;
+    const void* record = shm_ring_peek(ring, &len);
+    if (record == NULL)
+        return 0;
+    if (len > size)
+    {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    memcpy(buf, record, len);
+    shm_ring_consume(ring, len);
+    return len;
+}
+
+/**
+ * @brief Marks the end of the stream, like closing the write end of a pipe.
+ */
+static inline void shm_ring_close(shm_ring_t* ring)
+{
+    atomic_store_explicit(&ring->_closed, 1, memory_order_release);
+    atomic_thread_fence(memory_order_seq_cst);
+    atomic_fetch_add_explicit(&ring->_data_seq, 1, memory_order_relaxed);
+    futex_wake(&ring->_data_seq, 1);
+}
+
+#endif // SHM_RING_H
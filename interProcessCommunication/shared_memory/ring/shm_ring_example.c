@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <string.h>
+#include <errno.h>
+
+#include "shm_ring.h"
+#include "../../bench_common.h"
+
+// pipe_example.c with the two pipes replaced by two shared-memory rings.
+// The parent sends each line typed on stdin and the child echoes it back.
+//
+//   ./shm_ring_example              interactive echo
+//   ./shm_ring_example bench [MiB]  throughput of the ring against a pipe
+//
+// Build: gcc shm_ring_example.c -o shm_ring_example
+
+#define BUFFER_SIZE 256
+#define RING_CAPACITY (1u << 20)
+#define PARENT_TO_CHILD_RING "/shm_ring_parent_to_child"
+#define CHILD_TO_PARENT_RING "/shm_ring_child_to_parent"
+
+static shm_ring_t* attach_or_exit(const char* name)
+{
+    shm_ring_t* ring = shm_ring_attach(name, RING_CAPACITY, NULL);
+    if (ring == NULL)
+    {
+        perror("shm_ring_attach failed");
+        exit(EXIT_FAILURE);
+    }
+    return ring;
+}
+
+static int run_echo(void)
+{
+    // Leftovers from a killed run would carry its head/tail; start clean.
+    shm_unlink(PARENT_TO_CHILD_RING);
+    shm_unlink(CHILD_TO_PARENT_RING);
+
+    pid_t cpid = fork();
+    if (cpid == -1)
+    {
+        perror("fork failed");
+        exit(EXIT_FAILURE);
+    }
+
+    // Both processes attach by name; whichever gets there first creates the ring.
+    shm_ring_t* parent_to_child = attach_or_exit(PARENT_TO_CHILD_RING);
+    shm_ring_t* child_to_parent = attach_or_exit(CHILD_TO_PARENT_RING);
+
+    if (cpid == 0)
+    {
+        // --- Child Process ---
+        char buffer[BUFFER_SIZE];
+        ssize_t bytes_read;
+
+        // Loop, reading from parent and echoing back, until the parent closes its ring
+        while ((bytes_read = shm_ring_read(parent_to_child, buffer, BUFFER_SIZE - 1)) > 0)
+        {
+            buffer[bytes_read] = '\0';
+            printf("Child received: \'%s\'\n", buffer);
+
+            printf("Child echoing back...\n\n");
+            shm_ring_write(child_to_parent, buffer, bytes_read);
+        }
+
+        if (bytes_read == -1)
+            perror("Child: read failed");
+
+        shm_ring_close(child_to_parent);
+        shm_ring_detach(parent_to_child);
+        shm_ring_detach(child_to_parent);
+        printf("Child exiting.\n");
+        exit(EXIT_SUCCESS);
+    }
+
+    // --- Parent Process ---
+    char buffer[BUFFER_SIZE];
+
+    printf("Parent: Type a message to send to the child (or 'quit' to exit):\n");
+
+    while (1)
+    {
+        printf("> ");
+        fflush(stdout);
+        if (fgets(buffer, BUFFER_SIZE, stdin) == NULL)
+            break;
+        buffer[strcspn(buffer, "\n")] = 0; // Remove newline
+
+        if (strcmp(buffer, "quit") == 0)
+            break;
+
+        shm_ring_write(parent_to_child, buffer, strlen(buffer));
+
+        ssize_t bytes_read = shm_ring_read(child_to_parent, buffer, BUFFER_SIZE - 1);
+        if (bytes_read <= 0)
+            break;
+        buffer[bytes_read] = '\0';
+        printf("Parent received echo: \'%s\'\n", buffer);
+    }
+
+    // Closing the ring is the EOF the child's read loop waits for
+    shm_ring_close(parent_to_child);
+    wait(NULL);
+    shm_ring_detach(parent_to_child);
+    shm_ring_detach(child_to_parent);
+    shm_unlink(PARENT_TO_CHILD_RING);
+    shm_unlink(CHILD_TO_PARENT_RING);
+    printf("Parent exiting.\n");
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Streams total bytes in size-byte messages from parent to child and
+ * returns the throughput in MiB/s. The child copies every message out, so
+ * both transports touch the payload the same number of times in user space.
+ */
+static double bench_ring(size_t size, size_t total)
+{
+    shm_unlink(PARENT_TO_CHILD_RING);
+    char* buffer = malloc(size);
+    memset(buffer, 'x', size);
+
+    uint64_t start = now_ns();
+    pid_t cpid = fork();
+    if (cpid == -1)
+    {
+        perror("fork failed");
+        exit(EXIT_FAILURE);
+    }
+    shm_ring_t* ring = attach_or_exit(PARENT_TO_CHILD_RING);
+
+    if (cpid == 0)
+    {
+        size_t received = 0;
+        ssize_t n;
+        while ((n = shm_ring_read(ring, buffer, size)) > 0)
+            received += n;
+        _exit(received == total ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    for (size_t sent = 0; sent < total; sent += size)
+        shm_ring_write(ring, buffer, size);
+    shm_ring_close(ring);
+
+    int status;
+    waitpid(cpid, &status, 0);
+    uint64_t elapsed = now_ns() - start;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+        fprintf(stderr, "ring: child did not receive every byte\n");
+
+    shm_ring_detach(ring);
+    shm_unlink(PARENT_TO_CHILD_RING);
+    free(buffer);
+    return (double)total / (1 << 20) / (elapsed / 1e9);
+}
+
+static double bench_pipe(size_t size, size_t total)
+{
+    int fds[2];
+    if (pipe(fds) == -1)
+    {
+        perror("pipe failed");
+        exit(EXIT_FAILURE);
+    }
+    char* buffer = malloc(size);
+    memset(buffer, 'x', size);
+
+    uint64_t start = now_ns();
+    pid_t cpid = fork();
+    if (cpid == -1)
+    {
+        perror("fork failed");
+        exit(EXIT_FAILURE);
+    }
+
+    if (cpid == 0)
+    {
+        close(fds[1]);
+        size_t received = 0;
+        while (read_full(fds[0], buffer, size) == 0)
+            received += size;
+        _exit(received == total ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fds[0]);
+    for (size_t sent = 0; sent < total; sent += size)
+        write_full(fds[1], buffer, size);
+    close(fds[1]);
+
+    int status;
+    waitpid(cpid, &status, 0);
+    uint64_t elapsed = now_ns() - start;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+        fprintf(stderr, "pipe: child did not receive every byte\n");
+
+    free(buffer);
+    return (double)total / (1 << 20) / (elapsed / 1e9);
+}
+
+static int run_bench(size_t mib)
+{
+    static const size_t sizes[] = { 64, 1024, 16384, 262144 };
+    size_t total = mib << 20;
+
+    printf("%-10s %14s %14s %8s\n", "msg size", "pipe MiB/s", "ring MiB/s", "speedup");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        size_t size = sizes[i];
+        size_t rounded = total / size * size;
+        double pipe_rate = bench_pipe(size, rounded);
+        double ring_rate = bench_ring(size, rounded);
+        printf("%-10zu %14.1f %14.1f %7.2fx\n", size, pipe_rate, ring_rate, ring_rate / pipe_rate);
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return run_bench(argc > 2 ? strtoul(argv[2], NULL, 10) : 256);
+    return run_echo();
+}
@@ -1,15 +1,17 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #include <sys/sem.h>
 #include <errno.h>
+#include <limits.h>
 #include <unistd.h>
 
 
 #include "common.h"
 
-int main() {
+int main(int argc, char* argv[]) {
     key_t key;
     int shmid, semid;
 
@@ -50,9 +52,36 @@ int main() {
         perror("semget for cleanup");
     }
 
+    // Remove the data arena's segment
+    shmid = shmget(ftok(KEY_PATH, DATA_KEY_ID), 0, 0);
+    if (shmid != -1) {
+        if (shmctl(shmid, IPC_RMID, NULL) == -1) {
+            perror("shmctl data arena");
+        } else {
+            printf("Data arena segment removed.\n");
+        }
+    } else if (errno != ENOENT) {
+        perror("shmget data arena for cleanup");
+    }
+
     // Remove the key file
     unlink(KEY_PATH);
 
+    // -p also throws away the persistent table and content the downloaders kept there
+    if (argc == 3 && strcmp(argv[1], "-p") == 0) {
+        if (unlink(argv[2]) == 0)
+            printf("Cache file %s removed.\n", argv[2]);
+        else if (errno != ENOENT)
+            perror("unlink cache file");
+
+        char data_path[PATH_MAX];
+        snprintf(data_path, sizeof(data_path), "%s.data", argv[2]);
+        if (unlink(data_path) == 0)
+            printf("Data file %s removed.\n", data_path);
+        else if (errno != ENOENT)
+            perror("unlink data file");
+    }
+
     printf("Cleanup complete.\n");
     return 0;
 }
@@ -5,38 +5,32 @@
 #include <sys/ipc.h>
 #include <sys/sem.h>
 
+#include "../download_table.h"
+
 // Define a key for ftok() to find the shared memory and semaphore
 #define KEY_PATH "downloader_key_file"
 #define KEY_ID 'D'
-
+#define DATA_KEY_ID 'd' // The data arena's segment
+
+#ifdef USE_FUTEX_LOCK
+// Built with -DUSE_FUTEX_LOCK the lock is the futex word in the segment itself,
+// so an uncontended P/V is one atomic instead of a semop() syscall. The semaphore
+// set is still created to elect the first process; s is unused.
+#include "../futex_lock.h"
+#define P(s) futex_lock_acquire(&shared_data->_lock) // P operation (wait/lock)
+#define V(s) futex_lock_release(&shared_data->_lock) // V operation (signal/unlock)
+#else
 // A simple semaphore lock/unlock macro set
 #define P(s) semop(s, &pop, 1) // P operation (wait/lock)
 #define V(s) semop(s, &vop, 1) // V operation (signal/unlock)
-
-#define MAX_DOWNLOADS 10
-
-typedef enum
-{
-    STATUS_EMPTY = 0,
-    STATUS_IN_PROGRESS,
-    STATUS_COMPLETED
-} download_status_t;
-
-#define FILE_CONTENT_SIZE 1024
-#define FILE_NAME_SIZE 256
-
-// The structure that will be placed in shared memory
-typedef struct {
-    download_status_t _status;
-    pid_t _downloader_pid;
-    char _file_name[FILE_NAME_SIZE];
-    long _bytes_downloaded;
-    long _total_bytes;
-} download_slot_t;
+#endif
 
 typedef struct 
 {
-    download_slot_t _slots[MAX_DOWNLOADS];
+#ifdef USE_FUTEX_LOCK
+    futex_lock_t _lock; // Zero-filled by shmget(), which is the unlocked state
+#endif
+    download_table_t _table;
 } shared_data_t;
 
 #endif // DOWNLOAD_COMMON_H
\ No newline at end of file
@@ -6,28 +6,123 @@
 #include <sys/shm.h>
 #include <sys/sem.h>
 #include <errno.h>
+#include <limits.h>
 
 
 #include "common.h"
+#include "../persistent_segment.h"
+#include "../../bench_common.h"
 
-#define TOTAL_SIZE (100 * 1024 * 1024) // Simulate a 100MB file
-#define CHUNK_SIZE (10 * 1024 * 1024)  // Simulate downloading in 10MB chunks
+#define TOTAL_SIZE (32 * 1024 * 1024) // Simulate a 32MB file
+#define CHUNK_SIZE (4 * 1024 * 1024)  // Simulate downloading in 4MB chunks
+
+/**
+ * @brief Follows another process's download of name in the given slot without
+ * taking the lock: progress comes from seqlock snapshots, and the wait sleeps
+ * on the slot's sequence word. Returns once the download is complete or the
+ * slot stopped tracking name (its downloader died and the slot was freed or
+ * reused); either way the caller looks the name up again under the lock.
+ */
+static void wait_for_download(download_slot_t* shared_slot, const char* fileName, int* waited)
+{
+    pid_t my_pid = getpid();
+    uint64_t hash = download_name_hash(fileName);
+    download_snapshot_t snap;
+    while (1)
+    {
+        if (slot_read(shared_slot, &snap) < 0)
+        {
+            // A writer stopped mid-update; wait for it (or the re-check timeout)
+            slot_wait(shared_slot, atomic_load_explicit(&shared_slot->_seq, memory_order_relaxed));
+            continue;
+        }
+        if (snap._name_hash != hash || snap._status == STATUS_EMPTY)
+            return;
+        if (snap._status == STATUS_COMPLETED)
+        {
+            if (*waited)
+                printf("Process %d: Saw the completion %.1f us after it was marked.\n", my_pid, (now_ns() - snap._completed_ns) / 1e3);
+            return;
+        }
+        printf("Process %d: Download of '%s' is in progress by PID %d. Waiting ... %ld%% downloaded\n", my_pid, fileName, snap._downloader_pid, snap._bytes_downloaded * 100 / snap._total_bytes);
+        // Sleep until the downloader publishes progress or completion
+        slot_wait(shared_slot, snap._seq);
+        *waited = 1;
+    }
+}
+
+/**
+ * @brief Stands in for the network: fills a chunk of the file with bytes that
+ * depend on the file and the position, so every reader can checksum them.
+ */
+static void fetch_chunk(char* dest, long bytes, uint64_t seed, long offset)
+{
+    for (long i = 0; i + (long)sizeof(uint64_t) <= bytes; i += sizeof(uint64_t))
+    {
+        uint64_t word = seed ^ ((uint64_t)(offset + i) * 0x9E3779B97F4A7C15ull);
+        memcpy(dest + i, &word, sizeof(word));
+    }
+}
+
+/**
+ * @brief Makes a table read back from a persistent segment usable. Called by
+ * the process that attached alone, before anyone else can see the table.
+ */
+static void open_persistent_table(download_table_t* table, persist_state_t state)
+{
+    pid_t my_pid = getpid();
+    if (state == PERSIST_FRESH)
+    {
+        printf("Process %d: New cache file. Initializing the table.\n", my_pid);
+        download_table_init(table);
+    }
+    else if (state == PERSIST_DIRTY)
+    {
+        uint32_t reset = download_table_recover(table);
+        printf("Process %d: Cache was not closed cleanly. Rebuilt the table, reset %u unfinished downloads.\n", my_pid, reset);
+    }
+    else
+    {
+        uint32_t reset = download_table_reset_in_progress(table);
+        printf("Process %d: Reusing the cache, reset %u unfinished downloads.\n", my_pid, reset);
+    }
+}
 
 int main(int argc, char* argv[])
 {
-    if(argc != 2)
+    const char* persist_path = NULL;
+    int opt, bad_args = 0;
+    while ((opt = getopt(argc, argv, "p:")) != -1)
+    {
+        if (opt == 'p')
+            persist_path = optarg;
+        else
+            bad_args = 1;
+    }
+    if(bad_args || optind != argc - 1)
+    {
+        fprintf(stderr, "usage: %s [-p cache_file] <fileName>\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    char *fileName = argv[optind];
+    if (strlen(fileName) >= FILE_NAME_SIZE)
     {
-        fprintf(stderr, "usage: %s <fileName>", argv[0]);
+        fprintf(stderr, "file name is longer than %d characters\n", FILE_NAME_SIZE - 1);
         exit(EXIT_FAILURE);
     }
-    char *fileName = argv[1];
 
     pid_t my_pid = getpid();
     key_t key;
     int shmid, semid;
     shared_data_t *shared_data;
+    persistent_segment_t segment = { ._fd = -1 };
+    char data_path[PATH_MAX];
+    const char* arena_path = NULL; // File content: <cache_file>.data, or a SysV segment
+    key_t data_key = IPC_PRIVATE;
+#ifndef USE_FUTEX_LOCK
     struct sembuf pop = {0, -1, SEM_UNDO}; // P operation
     struct sembuf vop = {0, 1, SEM_UNDO};  // V operation
+#endif
 
     // Create a file for ftok if it doesn't exist
     FILE* fp = fopen(KEY_PATH, "w");
@@ -46,6 +141,7 @@ int main(int argc, char* argv[])
         perror("ftok");
         exit(1);
     }
+    data_key = ftok(KEY_PATH, DATA_KEY_ID);
 
     // 2. Get or create the semaphore set
     semid = semget(key, 1, 0666 | IPC_CREAT | IPC_EXCL);
@@ -77,114 +173,138 @@ int main(int argc, char* argv[])
         exit(1);
     }
 
-    // 3. Get or create the shared memory segment
-    shmid = shmget(key, sizeof(shared_data_t), 0666 | IPC_CREAT);
-    if (shmid == -1)
+    if (persist_path)
     {
-        perror("shmget");
-        exit(1);
+        // The table lives in a file and survives cleanup and restarts
+        if (persistent_segment_open(&segment, persist_path, sizeof(shared_data_t), DOWNLOAD_TABLE_VERSION, KEY_ID) == -1)
+            exit(1);
+        shared_data = segment._data;
+        snprintf(data_path, sizeof(data_path), "%s.data", persist_path);
+        arena_path = data_path;
+        if (segment._exclusive)
+        {
+#ifdef USE_FUTEX_LOCK
+            // Nobody else is attached: whatever the lock held before is stale
+            futex_lock_init(&shared_data->_lock);
+#endif
+            open_persistent_table(&shared_data->_table, segment._state);
+        }
+        persistent_segment_ready(&segment);
     }
-
-    // 4. Attach the shared memory
-    shared_data = shmat(shmid, NULL, 0);
-    if (shared_data == (void *)-1)
+    else
     {
-        perror("shmat");
-        exit(1);
-    }
+        // 3. Get or create the shared memory segment
+        shmid = shmget(key, sizeof(shared_data_t), 0666 | IPC_CREAT);
+        if (shmid == -1)
+        {
+            perror("shmget");
+            exit(1);
+        }
 
-    if(is_first_process)
-    {
-        P(semid); // --- LOCK ---
-        for(int i = 0; i < MAX_DOWNLOADS; i++)
+        // 4. Attach the shared memory
+        shared_data = shmat(shmid, NULL, 0);
+        if (shared_data == (void *)-1)
         {
-            shared_data->_slots[i]._status = STATUS_EMPTY;
+            perror("shmat");
+            exit(1);
+        }
+
+        if(is_first_process)
+        {
+            P(semid); // --- LOCK ---
+            download_table_init(&shared_data->_table);
+            V(semid); // --- UNLOCK ---
         }
-        V(semid); // --- UNLOCK ---
     }
 
     printf("Process %d: Wants to download '%s'.\n", my_pid, fileName);
     // Main logic loop
     int slot_index = -1;
+    int waited = 0;
+    uint64_t content_offset = 0;
+    long content_bytes = 0;
     while (1)
     {
         P(semid); // --- LOCK ---
 
-        for(int i = 0; i < MAX_DOWNLOADS; i++)
-        {
-            download_slot_t *shared_slot = &shared_data->_slots[i];
-            if(shared_slot->_status != STATUS_EMPTY
-                && strcmp(shared_slot->_file_name, fileName) == 0)
-            {
-                slot_index = i;
-                break;
-            }
-        }
+        // Hashed lookup: O(1) however many files the table tracks
+        slot_index = download_table_find(&shared_data->_table, fileName);
 
         if(slot_index != -1)
         {
-            download_slot_t *shared_slot = &shared_data->_slots[slot_index];
-            if(shared_slot->_status == STATUS_COMPLETED)
+            download_slot_t *shared_slot = &shared_data->_table._slots[slot_index];
+            if (shared_slot->_status == STATUS_COMPLETED)
             {
-                printf("Process %d: File '%s' is already downloaded. Using it.\n", my_pid, fileName);
+                // A hit: the reference keeps the slot from being evicted while in use
+                download_table_acquire(&shared_data->_table, slot_index);
+                content_offset = shared_slot->_data_offset;
+                content_bytes = shared_slot->_total_bytes;
                 V(semid); // --- UNLOCK ---
+                printf("Process %d: File '%s' is already downloaded. Using it.\n", my_pid, fileName);
                 break;
             }
-            else // Status In Progress
-            {
-                printf("Process %d: Download of '%s' is in progress by PID %d. Waiting ... %ld%% downloaded\n", my_pid, fileName, shared_slot->_downloader_pid, shared_slot->_bytes_downloaded * 100 / shared_slot->_total_bytes);
-                V(semid); // -- UNLOCK --
-                sleep(1); // Wait a bit before checking again
-                continue; // Go to the start of the while loop
-            }
+            // Status and progress are read lock-free from here on
+            V(semid); // --- UNLOCK ---
+            wait_for_download(shared_slot, fileName, &waited);
+            continue; // Look the name up again: completed, or the slot changed hands
         }
         else
         {
-            // find an empty slot
-            for(int i = 0; i < MAX_DOWNLOADS; i++)
+            // Claim a free slot, evicting an unused one if the table is full; this also interns the name
+            slot_index = download_table_insert(&shared_data->_table, fileName);
+
+            if(slot_index == -1)
             {
-                download_slot_t* shared_slot = &shared_data->_slots[i];
-                if(shared_slot->_status == STATUS_EMPTY)
-                {
-                    slot_index = i;
-                    break;
-                }
+                printf("Process %d: Every slot is in use, none to evict for '%s'. Exiting\n", my_pid, fileName);
+                V(semid); // --- UNLOCK ---
+                exit(1);
             }
+            download_slot_t* shared_slot = &shared_data->_table._slots[slot_index];
 
-            if(slot_index == -1)
+            // Reserve room for the content in the arena, evicting as needed; the slot owns it from now on
+            uint64_t data_capacity;
+            if (download_table_reserve_data(&shared_data->_table, TOTAL_SIZE, &content_offset, &data_capacity) == -1)
             {
-                printf("Process %d: No empty slots for '%s'. Exiting\n", my_pid, fileName);
+                printf("Process %d: The data arena is full of files in use, no room for '%s'. Exiting\n", my_pid, fileName);
+                download_table_remove(&shared_data->_table, slot_index);
                 V(semid); // --- UNLOCK ---
                 exit(1);
             }
-            printf("Process %d: I am the 'chosen one' for '%s'! Starting download.\n", my_pid, fileName);
-            download_slot_t* shared_slot = &shared_data->_slots[slot_index];
+            content_bytes = TOTAL_SIZE;
+            printf("Process %d: I am the 'chosen one' for '%s'! Starting download into %lu MB of the arena.\n", my_pid, fileName, (unsigned long)(data_capacity >> 20));
 
-            shared_slot->_status = STATUS_IN_PROGRESS;
-            shared_slot->_downloader_pid = my_pid;
-            strncpy(shared_slot->_file_name, fileName, sizeof(shared_slot->_file_name) - 1);
-            shared_slot->_total_bytes = TOTAL_SIZE;
-            shared_slot->_bytes_downloaded = 0;
+            slot_publish_claim(shared_slot, my_pid, TOTAL_SIZE, content_offset, data_capacity);
 
             // CRUCIAL: Release the lock before starting the long download
             V(semid); // --- UNLOCK ---
 
-            // --- Simulate a long download in chunks ---
+            char* arena = data_arena_map(arena_path, data_key, 1);
+            if (arena == NULL)
+            {
+                // Give the slot back, or its waiters would wait for this download forever
+                P(semid); // --- LOCK ---
+                download_table_remove(&shared_data->_table, slot_index);
+                V(semid); // --- UNLOCK ---
+                exit(1);
+            }
+            uint64_t seed = download_name_hash(fileName);
+
+            // --- Simulate a long download in chunks, straight into the arena ---
             for (long downloaded_bytes = 0; downloaded_bytes < TOTAL_SIZE; downloaded_bytes += CHUNK_SIZE)
             {
                 printf("Process %d: Downloading '%s'... %.0f%%\n", my_pid, fileName, (double)(downloaded_bytes + CHUNK_SIZE) * 100 / TOTAL_SIZE);
                 sleep(1); // Simulate work for downloading a chunk
+                fetch_chunk(arena + content_offset + downloaded_bytes, CHUNK_SIZE, seed, downloaded_bytes);
 
-                // Lock, update progress, unlock
-                P(semid);
-                shared_data->_slots[slot_index]._bytes_downloaded = downloaded_bytes + CHUNK_SIZE;
-                V(semid);
+                // Only this process writes the slot's progress: no lock, just the seqlock
+                slot_publish_progress(shared_slot, downloaded_bytes + CHUNK_SIZE);
             }
 
             // --- Re-acquire the lock to finalize ---
+            data_arena_unmap(arena_path, arena);
             printf("Process %d: Download of '%s' finished. Acquiring lock to write to memory...\n", my_pid, fileName);
             P(semid); // --- LOCK ---
-            shared_data->_slots[slot_index]._status = STATUS_COMPLETED;
+            slot_publish_complete(shared_slot, now_ns());
             printf("Process %d: Wrote to shared memory and marked as complete.\n", my_pid);
             V(semid); // --- UNLOCK ---
 
@@ -193,11 +313,25 @@ int main(int argc, char* argv[])
 
     }
     // Now, every process that reaches this point can use the data
+    // Every process, the downloader included, reads the one copy in the arena in place
+    const char* arena = data_arena_map(arena_path, data_key, 0);
+    if (arena == NULL)
+        exit(1);
     printf("\n--- Process %d is now using the file '%s' ---\n", my_pid, fileName);
+    printf("%ld bytes mapped read-only at arena offset %lu, checksum %016lx\n", content_bytes,
+           (unsigned long)content_offset, (unsigned long)data_checksum(arena + content_offset, content_bytes));
     printf("-----------------------------------------\n\n");
+    data_arena_unmap(arena_path, (char*)arena);
+
+    // Done with the content: the slot may be evicted once nobody else uses it
+    P(semid); // --- LOCK ---
+    download_table_release(&shared_data->_table, slot_index);
+    V(semid); // --- UNLOCK ---
 
     // Detach from shared memory
-    if (shmdt(shared_data) == -1)
+    if (persist_path)
+        persistent_segment_close(&segment);
+    else if (shmdt(shared_data) == -1)
     {
         perror("shmdt");
         exit(1);
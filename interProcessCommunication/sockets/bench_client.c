@@ -0,0 +1,444 @@
+// bench_client.c
+#define _GNU_SOURCE // recvmmsg/sendmmsg
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/resource.h>
+
+#include "constants.h"
+#include "message_socket.h"
+#include "rpc_client.h"
+#include "../bench_common.h"
+
+// Compile with:
+// gcc -O2 bench_client.c -o bench_client -pthread
+//
+// Usage: ./bench_client [-m connect|echo|rpc] [-c clients] [-n requests] [-s size] [-i idle]
+//                       [-p stream|seqpacket|dgram] [-b batch] [-w window]
+//   -m connect  connection rate: each request is connect + one echo + close
+//   -m echo     echo latency: every client keeps one connection and does -n round trips
+//   -m rpc      pipelined RPC (rpc_client.h) against "./server -m rpc": every
+//               client keeps up to -w echo requests in flight on one connection
+//   -c          concurrent client threads (default 1)
+//   -n          requests per client (default 10000)
+//   -s          message size in bytes (default 64)
+//   -i          extra idle connections held open for the whole run (default 0)
+//   -p          socket type (default stream); the server must use the same
+//   -b          messages per request, 1 to MMSG_BATCH (default 1). Stream sends
+//               them as one write; seqpacket and dgram use one sendmmsg() and
+//               recvmmsg() for the batch, as far as flow control allows
+//   -w          requests in flight per client in rpc mode (default 64)
+//
+// Start the server under test first, e.g. "./server -q" or "./server -m epoll -q".
+// Messages/sec for small messages, stream against the message-preserving types:
+//   ./server -q            & ./bench_client -s 64 -b 64 -c 4
+//   ./server -q -p dgram   & ./bench_client -s 64 -b 64 -c 4 -p dgram
+
+typedef enum
+{
+    BENCH_CONNECT = 0,
+    BENCH_ECHO,
+    BENCH_RPC
+} bench_mode_t;
+
+typedef struct
+{
+    bench_mode_t _mode;
+    long _requests;
+    size_t _size;
+    int _batch;
+    uint64_t* _latencies; // _requests entries, owned by this client
+    int _failed;
+    int _window;
+    long _completed;      // RPC replies received so far
+} client_arg_t;
+
+typedef struct
+{
+    client_arg_t* _client;
+    uint64_t _start;
+} rpc_request_t;
+
+static int socket_type = SOCK_STREAM;
+
+static int connect_to_server(void)
+{
+    struct sockaddr_un server_addr;
+    int sock = socket(AF_UNIX, socket_type, 0);
+    if (sock == -1)
+    {
+        perror("socket");
+        return -1;
+    }
+    if (socket_type == SOCK_DGRAM && dgram_autobind(sock) == -1)
+    {
+        perror("bind");
+        close(sock);
+        return -1;
+    }
+
+    memset(&server_addr, 0, sizeof(struct sockaddr_un));
+    server_addr.sun_family = AF_UNIX;
+    strncpy(server_addr.sun_path, SOCKET_PATH, sizeof(server_addr.sun_path) - 1);
+
+    if (connect(sock, (struct sockaddr *)&server_addr, sizeof(struct sockaddr_un)) == -1)
+    {
+        perror("connect");
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+static int echo_once(int sock, char* buffer, size_t size)
+{
+    if (write_full(sock, buffer, size) == -1)
+        return -1;
+    return read_full(sock, buffer, size);
+}
+
+/**
+ * @brief Sends batch messages and receives their echoes over a seqpacket or
+ * datagram socket. A Unix socket only queues net.unix.max_dgram_qlen messages
+ * per receiver, so we never block on sending while replies are outstanding:
+ * the server may itself be blocked sending those replies to us. Returns 0 on
+ * success, -1 on error.
+ */
+static int echo_batch(int sock, struct mmsghdr* out, struct mmsghdr* in, int batch, size_t size)
+{
+    int sent = 0, received = 0;
+    while (received < batch)
+    {
+        int progress = 0;
+        if (sent < batch)
+        {
+            int n = sendmmsg(sock, out + sent, batch - sent, MSG_DONTWAIT);
+            // Nothing in flight, so no echo can be holding the server up:
+            // wait for room, but for one message only, or the echoes of the
+            // first ones could fill our queue while we are still sending.
+            if (n == -1 && errno == EAGAIN && sent == received)
+                n = sendmmsg(sock, out + sent, 1, 0);
+            if (n > 0)
+            {
+                sent += n;
+                progress = 1;
+            }
+            else if (errno != EAGAIN && errno != EINTR)
+                return -1;
+        }
+        if (received < sent)
+        {
+            // Block for at least one echo unless there is still sending to do
+            int flags = progress && sent < batch ? MSG_DONTWAIT : MSG_WAITFORONE;
+            int n = recvmmsg(sock, in + received, sent - received, flags, NULL);
+            if (n > 0)
+            {
+                for (int i = received; i < received + n; i++)
+                    if (in[i].msg_len != size)
+                        return -1;
+                received += n;
+            }
+            else if (n == 0 || (errno != EAGAIN && errno != EINTR))
+                return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief One request: batch messages out, batch echoes back.
+ */
+static int echo_request(int sock, char* buffer, client_arg_t* c, struct mmsghdr* out, struct mmsghdr* in)
+{
+    if (socket_type == SOCK_STREAM)
+        return echo_once(sock, buffer, c->_size * c->_batch);
+    return echo_batch(sock, out, in, c->_batch, c->_size);
+}
+
+static void rpc_done(void* ctx, uint32_t id, uint16_t status, const char* payload, size_t len)
+{
+    rpc_request_t* request = ctx;
+    client_arg_t* c = request->_client;
+    if (status != RPC_STATUS_OK || len != c->_size)
+        c->_failed = 1;
+    c->_latencies[c->_completed++] = now_ns() - request->_start;
+}
+
+/**
+ * @brief RPC mode: keeps the window full, refilling it as replies complete.
+ * A request's latency runs from its submit to its callback.
+ */
+static void rpc_client_run(client_arg_t* c)
+{
+    rpc_client_t* client = malloc(sizeof(rpc_client_t));
+    rpc_request_t* requests = malloc(c->_requests * sizeof(rpc_request_t));
+    char* payload = malloc(c->_size);
+    int sock = connect_to_server();
+    if (client == NULL || requests == NULL || payload == NULL || sock == -1
+        || rpc_client_init(client, sock, c->_window) == -1)
+    {
+        perror("rpc client");
+        c->_failed = 1;
+        goto out;
+    }
+    memset(payload, 'x', c->_size);
+
+    long submitted = 0;
+    while (c->_completed < c->_requests && !c->_failed)
+    {
+        while (submitted < c->_requests)
+        {
+            requests[submitted] = (rpc_request_t){ c, now_ns() };
+            if (rpc_submit(client, RPC_OP_ECHO, payload, c->_size, rpc_done, &requests[submitted]) == 0)
+                break; // Window full until something completes
+            submitted++;
+        }
+        if (rpc_poll(client, 1) == -1)
+        {
+            perror("rpc_poll");
+            c->_failed = 1;
+        }
+    }
+    rpc_client_destroy(client);
+
+out:
+    if (sock != -1)
+        close(sock);
+    free(payload);
+    free(requests);
+    free(client);
+}
+
+void* client_thread(void* arg)
+{
+    client_arg_t* c = arg;
+    if (c->_mode == BENCH_RPC)
+    {
+        rpc_client_run(c);
+        return NULL;
+    }
+
+    // Outgoing messages in the first half, echoes land in the second
+    char* buffer = malloc(c->_size * c->_batch * 2);
+    struct mmsghdr* hdrs = calloc(c->_batch * 2, sizeof(struct mmsghdr));
+    struct iovec* iovs = calloc(c->_batch * 2, sizeof(struct iovec));
+    if (buffer == NULL || hdrs == NULL || iovs == NULL)
+    {
+        c->_failed = 1;
+        free(buffer);
+        free(hdrs);
+        free(iovs);
+        return NULL;
+    }
+    memset(buffer, 'x', c->_size * c->_batch * 2);
+    for (int i = 0; i < c->_batch * 2; i++)
+    {
+        iovs[i].iov_base = buffer + i * c->_size;
+        iovs[i].iov_len = c->_size;
+        hdrs[i].msg_hdr.msg_iov = &iovs[i];
+        hdrs[i].msg_hdr.msg_iovlen = 1;
+    }
+    struct mmsghdr* out = hdrs;
+    struct mmsghdr* in = hdrs + c->_batch;
+
+    int sock = -1;
+    if (c->_mode == BENCH_ECHO && (sock = connect_to_server()) == -1)
+    {
+        c->_failed = 1;
+        free(buffer);
+        free(hdrs);
+        free(iovs);
+        return NULL;
+    }
+
+    for (long i = 0; i < c->_requests; ++i)
+    {
+        uint64_t start = now_ns();
+        if (c->_mode == BENCH_CONNECT)
+        {
+            sock = connect_to_server();
+            if (sock == -1 || echo_request(sock, buffer, c, out, in) == -1)
+            {
+                c->_failed = 1;
+                break;
+            }
+            close(sock);
+            sock = -1;
+        }
+        else if (echo_request(sock, buffer, c, out, in) == -1)
+        {
+            perror("echo");
+            c->_failed = 1;
+            break;
+        }
+        c->_latencies[i] = now_ns() - start;
+    }
+
+    if (sock != -1)
+        close(sock);
+    free(buffer);
+    free(hdrs);
+    free(iovs);
+    return NULL;
+}
+
+/**
+ * @brief Lets the process open as many sockets as the hard limit allows,
+ * so thousands of idle connections do not hit the default 1024.
+ */
+static void raise_fd_limit(void)
+{
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0)
+    {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bench_mode_t mode = BENCH_ECHO;
+    int clients = 1;
+    long requests = 10000;
+    size_t size = 64;
+    int idle = 0;
+    int batch = 1;
+    int window = 64;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:c:n:s:i:p:b:w:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'm':
+            if (strcmp(optarg, "connect") == 0)
+                mode = BENCH_CONNECT;
+            else if (strcmp(optarg, "echo") == 0)
+                mode = BENCH_ECHO;
+            else if (strcmp(optarg, "rpc") == 0)
+                mode = BENCH_RPC;
+            else
+            {
+                fprintf(stderr, "Unknown mode '%s'\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'c': clients = atoi(optarg); break;
+        case 'n': requests = atol(optarg); break;
+        case 's': size = strtoul(optarg, NULL, 10); break;
+        case 'i': idle = atoi(optarg); break;
+        case 'b': batch = atoi(optarg); break;
+        case 'w': window = atoi(optarg); break;
+        case 'p':
+            socket_type = socket_type_from_name(optarg);
+            if (socket_type == -1)
+            {
+                fprintf(stderr, "Unknown socket type '%s'\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-m connect|echo|rpc] [-c clients] [-n requests] [-s size] [-i idle] [-p stream|seqpacket|dgram] [-b batch] [-w window]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (clients < 1 || requests < 1 || size < 1 || idle < 0)
+    {
+        fprintf(stderr, "Clients, requests and size must be positive.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (batch < 1 || batch > MMSG_BATCH)
+    {
+        fprintf(stderr, "The batch must be 1 to %d messages.\n", MMSG_BATCH);
+        exit(EXIT_FAILURE);
+    }
+    if (socket_type != SOCK_STREAM && size > BUFFER_SIZE)
+    {
+        fprintf(stderr, "Messages over %d bytes would be truncated by the server.\n", BUFFER_SIZE);
+        exit(EXIT_FAILURE);
+    }
+    if (mode == BENCH_RPC && (socket_type != SOCK_STREAM || batch != 1 || size > RPC_MAX_PAYLOAD
+                              || window < 1 || window > RPC_MAX_WINDOW))
+    {
+        fprintf(stderr, "rpc mode runs over stream sockets with -w 1 to %d and -s up to %zu (no -b).\n",
+                RPC_MAX_WINDOW, RPC_MAX_PAYLOAD);
+        exit(EXIT_FAILURE);
+    }
+    if (socket_type == SOCK_DGRAM && (mode == BENCH_CONNECT || idle > 0))
+    {
+        fprintf(stderr, "Datagram sockets have no connections to open.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    raise_fd_limit();
+
+    // Idle connections only cost the server memory (and, in fork mode, a process each).
+    int* idle_socks = calloc(idle > 0 ? idle : 1, sizeof(int));
+    for (int i = 0; i < idle; ++i)
+    {
+        idle_socks[i] = connect_to_server();
+        if (idle_socks[i] == -1)
+        {
+            fprintf(stderr, "Could only open %d idle connections.\n", i);
+            idle = i;
+            break;
+        }
+    }
+
+    pthread_t* tids = calloc(clients, sizeof(pthread_t));
+    client_arg_t* args = calloc(clients, sizeof(client_arg_t));
+    uint64_t* latencies = malloc(clients * requests * sizeof(uint64_t));
+    if (tids == NULL || args == NULL || latencies == NULL)
+    {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < clients; ++i)
+    {
+        args[i] = (client_arg_t){ mode, requests, size, batch, latencies + i * requests, 0, window, 0 };
+        pthread_create(&tids[i], NULL, client_thread, &args[i]);
+    }
+    int failed = 0;
+    for (int i = 0; i < clients; ++i)
+    {
+        pthread_join(tids[i], NULL);
+        failed |= args[i]._failed;
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    for (int i = 0; i < idle; ++i)
+        close(idle_socks[i]);
+
+    if (failed)
+    {
+        fprintf(stderr, "Some clients failed; results are not valid.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    long total = clients * requests;
+    qsort(latencies, total, sizeof(uint64_t), compare_u64);
+    printf("mode=%s socket=%s clients=%d idle=%d size=%zu batch=%d window=%d requests=%ld\n",
+           mode == BENCH_CONNECT ? "connect" : mode == BENCH_RPC ? "rpc" : "echo",
+           socket_type_name(socket_type), clients, idle, size, batch,
+           mode == BENCH_RPC ? window : 1, total);
+    printf("%s/sec: %.0f\n", mode == BENCH_CONNECT ? "connections" : "requests", total / (elapsed / 1e9));
+    printf("messages/sec: %.0f\n", total * batch / (elapsed / 1e9));
+    printf("latency p50: %llu ns, p99: %llu ns, p99.9: %llu ns\n",
+           (unsigned long long)percentile_u64(latencies, total, 50),
+           (unsigned long long)percentile_u64(latencies, total, 99),
+           (unsigned long long)percentile_u64(latencies, total, 99.9));
+
+    free(idle_socks);
+    free(tids);
+    free(args);
+    free(latencies);
+    return 0;
+}
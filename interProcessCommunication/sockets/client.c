@@ -1,4 +1,5 @@
 // client.c
+#define _GNU_SOURCE // memfd_create() in fd_passing.h, recvmmsg/sendmmsg
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,33 +8,177 @@
 #include <sys/un.h>
 
 #include "constants.h"
+#include "fd_passing.h"
+#include "message_socket.h"
+#include "../bench_common.h"
 
-int main()
+// Usage: ./client                     interactive echo
+//        ./client -s bytes [-T bytes]  send one generated payload of that size;
+//                                      payloads of at least -T bytes (default
+//                                      64 KiB) go as a sealed memfd, smaller
+//                                      ones inline through the echo stream
+//        ./client -p seqpacket|dgram   interactive echo over a socket type that
+//                                      keeps message boundaries (start the
+//                                      server with the same -p)
+
+/**
+ * @brief Sends a payload inline: BUFFER_SIZE-sized writes, each followed by
+ * reading its echo, as the interactive loop does. Returns 0 on success.
+ */
+int send_inline(int client_sock, const char* data, size_t len, unsigned long* syscalls)
+{
+    char buffer[BUFFER_SIZE];
+    for (size_t off = 0; off < len;)
+    {
+        size_t chunk = len - off < sizeof(buffer) - 1 ? len - off : sizeof(buffer) - 1;
+        if (write(client_sock, data + off, chunk) < 0)
+            return -1;
+        (*syscalls)++;
+        for (size_t echoed = 0; echoed < chunk;)
+        {
+            int n = read(client_sock, buffer, chunk - echoed);
+            (*syscalls)++;
+            if (n <= 0)
+                return -1;
+            echoed += n;
+        }
+        off += chunk;
+    }
+    return 0;
+}
+
+/**
+ * @brief Sends a payload as a sealed memfd and reads the server's reply into
+ * reply. The payload is written once into the memfd; the server maps the same
+ * pages. Returns 0 on success.
+ */
+int send_memfd(int client_sock, const char* data, size_t len, char* reply, size_t reply_size, unsigned long* syscalls)
+{
+    // memfd_create, write, fcntl(F_ADD_SEALS)
+    int fd = memfd_from_buffer("payload", data, len);
+    *syscalls += 3;
+    if (fd == -1)
+        return -1;
+
+    // One marker byte carries the descriptor
+    int rc = send_fd(client_sock, fd, "F", 1);
+    close(fd);
+    *syscalls += 2;
+    if (rc == -1)
+        return -1;
+
+    int n = read(client_sock, reply, reply_size - 1);
+    (*syscalls)++;
+    if (n <= 0)
+        return -1;
+    reply[n] = '\0';
+    return 0;
+}
+
+/**
+ * @brief Sends one payload of `size` bytes the way its size calls for and
+ * reports the time and syscalls it took.
+ */
+int send_payload(int client_sock, size_t size, size_t threshold)
+{
+    char* data = malloc(size);
+    for (size_t i = 0; i < size; i++)
+        data[i] = (char)(i * 7 + 1);
+
+    char reply[BUFFER_SIZE] = "";
+    unsigned long syscalls = 0;
+    int use_memfd = size >= threshold;
+
+    uint64_t start = now_ns();
+    int rc = use_memfd ? send_memfd(client_sock, data, size, reply, sizeof(reply), &syscalls)
+                       : send_inline(client_sock, data, size, &syscalls);
+    uint64_t elapsed = now_ns() - start;
+
+    if (rc == -1)
+        perror("send payload");
+    else
+    {
+        printf("Sent %zu bytes %s in %.2f ms with %lu client syscalls (checksum %08x)\n",
+               size, use_memfd ? "as a memfd" : "inline", elapsed / 1e6, syscalls, payload_checksum(data, size));
+        if (use_memfd)
+            printf("Server replied: %s\n", reply);
+    }
+    free(data);
+    return rc;
+}
+
+int main(int argc, char* argv[])
 {
     int client_sock;
     struct sockaddr_un server_addr;
     char buffer[BUFFER_SIZE];
+    size_t payload_size = 0;
+    size_t threshold = MEMFD_DEFAULT_THRESHOLD;
+    int socket_type = SOCK_STREAM;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:T:p:")) != -1)
+    {
+        switch (opt)
+        {
+        case 's':
+            payload_size = strtoull(optarg, NULL, 10);
+            break;
+        case 'T':
+            threshold = strtoull(optarg, NULL, 10);
+            break;
+        case 'p':
+            socket_type = socket_type_from_name(optarg);
+            if (socket_type == -1)
+            {
+                fprintf(stderr, "Unknown socket type '%s'\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-s bytes] [-T threshold] [-p stream|seqpacket|dgram]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (payload_size > 0 && socket_type != SOCK_STREAM)
+    {
+        fprintf(stderr, "Payloads (-s) are only sent over stream sockets.\n");
+        exit(EXIT_FAILURE);
+    }
 
     // 1. Create a socket
-    client_sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    client_sock = socket(AF_UNIX, socket_type, 0);
     if (client_sock == -1)
     {
         perror("socket");
         exit(EXIT_FAILURE);
     }
+    // A datagram server replies to our address, so we need one
+    if (socket_type == SOCK_DGRAM && dgram_autobind(client_sock) == -1)
+    {
+        perror("bind");
+        exit(EXIT_FAILURE);
+    }
 
     // 2. Set up the server address
     memset(&server_addr, 0, sizeof(struct sockaddr_un));
     server_addr.sun_family = AF_UNIX;
     strncpy(server_addr.sun_path, SOCKET_PATH, sizeof(server_addr.sun_path) - 1);
 
-    // 3. Connect to the server
+    // 3. Connect to the server (for datagrams: only sets the default destination)
     if (connect(client_sock, (struct sockaddr *)&server_addr, sizeof(struct sockaddr_un)) == -1)
     {
         perror("connect");
         exit(EXIT_FAILURE);
     }
 
+    if (payload_size > 0)
+    {
+        int rc = send_payload(client_sock, payload_size, threshold);
+        close(client_sock);
+        return rc == 0 ? 0 : 1;
+    }
+
     printf("Connected to server. Type 'exit' to quit.\n");
 
     // 4. Communication loop
@@ -47,6 +192,9 @@ int main()
 
         if (strcmp(buffer, "exit") == 0)
             break;
+        // An empty seqpacket message reads like a closed connection
+        if (buffer[0] == '\0' && socket_type != SOCK_STREAM)
+            continue;
 
         // Send message to server
         if (write(client_sock, buffer, strlen(buffer)) < 0)
@@ -1,3 +1,9 @@
 #define SOCKET_PATH "/tmp/demo_socket"
 #define BUFFER_SIZE 256
 
+// Pending-connection queue for listen(); large enough for connect-rate benchmarks.
+#define LISTEN_BACKLOG 128
+
+// Per-connection read and write buffers of the epoll server.
+#define CONN_BUFFER_SIZE 16384
+#define MAX_EPOLL_EVENTS 64
@@ -0,0 +1,314 @@
+// epoll_server.c
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+
+#include "epoll_server.h"
+#include "rpc_protocol.h"
+
+typedef struct
+{
+    int _server_sock;
+    int _epoll_fd;
+    protocol_handler_t _handler;
+    server_stats_t* _stats;
+    int _verbose;
+} event_loop_t;
+
+static int set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1)
+        return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+int echo_protocol(connection_t* conn)
+{
+    // Move as much input as fits into the write buffer.
+    size_t room = CONN_BUFFER_SIZE - conn->_wlen;
+    size_t n = conn->_rlen < room ? conn->_rlen : room;
+    if (n == 0)
+        return 0;
+
+    memcpy(conn->_wbuf + conn->_wlen, conn->_rbuf, n);
+    conn->_wlen += n;
+    memmove(conn->_rbuf, conn->_rbuf + n, conn->_rlen - n);
+    conn->_rlen -= n;
+    return 1;
+}
+
+int rpc_protocol(connection_t* conn)
+{
+    size_t off = 0;
+    int answered = 0;
+    while (conn->_rlen - off >= RPC_HEADER_SIZE)
+    {
+        rpc_header_t request;
+        memcpy(&request, conn->_rbuf + off, RPC_HEADER_SIZE);
+        if (request._length > RPC_MAX_PAYLOAD)
+            return -1;
+        if (conn->_rlen - off < RPC_HEADER_SIZE + request._length)
+            break; // The rest of this frame has not arrived yet
+
+        rpc_header_t reply = { 0, request._id, request._op, RPC_STATUS_OK };
+        if (request._op == RPC_OP_ECHO)
+            reply._length = request._length;
+        else if (request._op != RPC_OP_PING)
+            reply._status = RPC_STATUS_UNKNOWN_OP;
+        if (conn->_wlen + RPC_HEADER_SIZE + reply._length > CONN_BUFFER_SIZE)
+            break; // Resume once the socket has taken some of _wbuf
+
+        // Replies queue up behind each other in _wbuf and leave in one write.
+        memcpy(conn->_wbuf + conn->_wlen, &reply, RPC_HEADER_SIZE);
+        memcpy(conn->_wbuf + conn->_wlen + RPC_HEADER_SIZE, conn->_rbuf + off + RPC_HEADER_SIZE, reply._length);
+        conn->_wlen += RPC_HEADER_SIZE + reply._length;
+        off += RPC_HEADER_SIZE + request._length;
+        answered++;
+    }
+
+    if (off == 0)
+        return 0;
+    memmove(conn->_rbuf, conn->_rbuf + off, conn->_rlen - off);
+    conn->_rlen -= off;
+    return answered;
+}
+
+/**
+ * @brief Reads, runs the protocol and writes until every step would block.
+ *
+ * With edge-triggered epoll we are only told when the state changes, so we must
+ * drive each direction until it returns EAGAIN (or cannot move for lack of buffer
+ * space). A partial write leaves the rest in _wbuf; the next EPOLLOUT edge
+ * brings us back here to finish it. While _wbuf is full we stop reading, which
+ * pushes back on a client that sends faster than it reads.
+ *
+ * Replies are only written once the socket has no more input for us (or
+ * there is no room to take more): whatever the protocol produced for all the
+ * requests of one readiness event then goes out in a single write().
+ *
+ * Returns -1 when the connection should be closed.
+ */
+static int connection_service(event_loop_t* loop, connection_t* conn)
+{
+    // Once a read has returned EAGAIN, new input raises a fresh edge anyway
+    int readable = 1;
+
+    for (;;)
+    {
+        int progress = 0;
+        int more_input = 0;
+
+        if (readable && !conn->_eof && conn->_rlen < CONN_BUFFER_SIZE)
+        {
+            ssize_t n = read(conn->_fd, conn->_rbuf + conn->_rlen, CONN_BUFFER_SIZE - conn->_rlen);
+            stats_add(&loop->_stats->_syscalls, 1);
+            if (n > 0)
+            {
+                conn->_rlen += n;
+                progress = 1;
+                more_input = 1;
+            }
+            else if (n == 0)
+            {
+                conn->_eof = 1;
+                progress = 1;
+            }
+            else if (errno == EAGAIN)
+                readable = 0;
+            else if (errno != EINTR)
+            {
+                perror("read");
+                return -1;
+            }
+        }
+
+        int handled = loop->_handler(conn);
+        if (handled == -1)
+            return -1;
+        stats_add(&loop->_stats->_requests, handled);
+        progress |= handled > 0;
+
+        // Keep reading while the last read returned data and the protocol
+        // still has room to reply; flush when either runs out.
+        int flush = !more_input || handled == 0;
+        if (flush && conn->_woff < conn->_wlen)
+        {
+            ssize_t n = write(conn->_fd, conn->_wbuf + conn->_woff, conn->_wlen - conn->_woff);
+            stats_add(&loop->_stats->_syscalls, 1);
+            if (n > 0)
+            {
+                conn->_woff += n;
+                if (conn->_woff == conn->_wlen)
+                    conn->_woff = conn->_wlen = 0;
+                progress = 1;
+            }
+            else if (n == -1 && errno != EAGAIN && errno != EINTR)
+            {
+                if (errno != EPIPE && errno != ECONNRESET)
+                    perror("write");
+                return -1;
+            }
+        }
+
+        if (!progress)
+            break;
+    }
+
+    // Close once the peer is done and everything owed to it has been sent.
+    if (conn->_eof && conn->_wlen == 0)
+        return -1;
+    return 0;
+}
+
+static void connection_close(event_loop_t* loop, connection_t* conn)
+{
+    if (loop->_verbose)
+        printf("Client disconnected.\n");
+    // Closing the fd also removes it from the epoll set.
+    close(conn->_fd);
+    stats_add(&loop->_stats->_syscalls, 1);
+    free(conn);
+}
+
+/**
+ * @brief Accepts every pending connection and registers it with this loop.
+ */
+static void accept_connections(event_loop_t* loop)
+{
+    for (;;)
+    {
+        int client_sock = accept4(loop->_server_sock, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        stats_add(&loop->_stats->_syscalls, 1);
+        if (client_sock == -1)
+        {
+            if (errno != EAGAIN && errno != EINTR && errno != ECONNABORTED)
+                perror("accept");
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            return;
+        }
+
+        connection_t* conn = calloc(1, sizeof(connection_t));
+        if (conn == NULL)
+        {
+            perror("calloc");
+            close(client_sock);
+            continue;
+        }
+        conn->_fd = client_sock;
+        stats_add(&loop->_stats->_connections, 1);
+        stats_add(&loop->_stats->_syscalls, 1);
+
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data.ptr = conn };
+        if (epoll_ctl(loop->_epoll_fd, EPOLL_CTL_ADD, client_sock, &ev) == -1)
+        {
+            perror("epoll_ctl (client)");
+            close(client_sock);
+            free(conn);
+            continue;
+        }
+
+        if (loop->_verbose)
+            printf("Server: Accepted a new connection.\n");
+
+        // Data may have arrived before registration; the edge would be lost.
+        if (connection_service(loop, conn) == -1)
+            connection_close(loop, conn);
+    }
+}
+
+static void* event_loop_run(void* arg)
+{
+    event_loop_t* loop = arg;
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+
+    while (1)
+    {
+        int n = epoll_wait(loop->_epoll_fd, events, MAX_EPOLL_EVENTS, -1);
+        stats_add(&loop->_stats->_syscalls, 1);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            connection_t* conn = events[i].data.ptr;
+            if (conn == NULL)
+            {
+                accept_connections(loop);
+                continue;
+            }
+            if (connection_service(loop, conn) == -1)
+                connection_close(loop, conn);
+        }
+    }
+    return NULL;
+}
+
+int run_epoll_server(int server_sock, int threads, protocol_handler_t handler, server_stats_t* stats, int verbose)
+{
+    if (threads < 1)
+        threads = 1;
+
+    if (set_nonblocking(server_sock) == -1)
+    {
+        perror("fcntl");
+        return -1;
+    }
+
+    event_loop_t* loops = calloc(threads, sizeof(event_loop_t));
+    pthread_t* tids = calloc(threads, sizeof(pthread_t));
+    if (loops == NULL || tids == NULL)
+    {
+        perror("calloc");
+        return -1;
+    }
+
+    for (int i = 0; i < threads; ++i)
+    {
+        loops[i] = (event_loop_t){ server_sock, epoll_create1(EPOLL_CLOEXEC), handler, stats, verbose };
+        if (loops[i]._epoll_fd == -1)
+        {
+            perror("epoll_create1");
+            return -1;
+        }
+
+        // Every loop watches the listening socket. EPOLLEXCLUSIVE wakes only one
+        // of them per incoming connection instead of the whole herd.
+        struct epoll_event ev = { .events = EPOLLIN | (threads > 1 ? EPOLLEXCLUSIVE : 0), .data.ptr = NULL };
+        if (epoll_ctl(loops[i]._epoll_fd, EPOLL_CTL_ADD, server_sock, &ev) == -1)
+        {
+            perror("epoll_ctl (listener)");
+            return -1;
+        }
+    }
+
+    // The calling thread runs the first loop itself.
+    for (int i = 1; i < threads; ++i)
+    {
+        if (pthread_create(&tids[i], NULL, event_loop_run, &loops[i]) != 0)
+        {
+            perror("pthread_create");
+            return -1;
+        }
+    }
+    event_loop_run(&loops[0]);
+
+    for (int i = 1; i < threads; ++i)
+        pthread_join(tids[i], NULL);
+    free(loops);
+    free(tids);
+    return -1;
+}
@@ -0,0 +1,58 @@
+#ifndef EPOLL_SERVER_H
+#define EPOLL_SERVER_H
+
+#include <stddef.h>
+
+#include "constants.h"
+#include "server_stats.h"
+
+// Event-loop server: every connection is a non-blocking socket registered
+// edge-triggered with epoll, so one thread serves thousands of mostly idle
+// clients with no process or thread per connection.
+
+typedef struct
+{
+    int _fd;
+    int _eof; // The peer has shut down its write side
+
+    // Bytes read from the socket and not yet consumed by the protocol.
+    char _rbuf[CONN_BUFFER_SIZE];
+    size_t _rlen;
+
+    // Bytes produced by the protocol and not yet accepted by the socket.
+    // _woff is how much of it a previous (partial) write already sent.
+    char _wbuf[CONN_BUFFER_SIZE];
+    size_t _wlen;
+    size_t _woff;
+} connection_t;
+
+/**
+ * @brief Protocol callback. Consumes bytes from conn->_rbuf and appends
+ * replies to conn->_wbuf, shifting unconsumed input to the front.
+ * Returns how many requests it answered (counted in the server stats), 0 if
+ * it needs more input or more room in _wbuf, and -1 to drop the connection.
+ */
+typedef int (*protocol_handler_t)(connection_t* conn);
+
+/**
+ * @brief The echo protocol of handle_client(): every byte read is written back.
+ * Each call that moves input counts as one request.
+ */
+int echo_protocol(connection_t* conn);
+
+/**
+ * @brief The pipelined RPC protocol of rpc_protocol.h: answers every complete
+ * request frame in _rbuf, in order, as long as the replies fit in _wbuf, and
+ * returns the number of frames answered. Drops the connection on a frame longer than RPC_MAX_PAYLOAD.
+ */
+int rpc_protocol(connection_t* conn);
+
+/**
+ * @brief Serves the listening socket with `threads` event loops until an
+ * unrecoverable error. Each thread owns its own epoll instance and the
+ * connections it accepted. Syscalls and requests are counted in stats.
+ * Returns -1 on setup failure.
+ */
+int run_epoll_server(int server_sock, int threads, protocol_handler_t handler, server_stats_t* stats, int verbose);
+
+#endif // EPOLL_SERVER_H
@@ -0,0 +1,171 @@
+#ifndef FD_PASSING_H
+#define FD_PASSING_H
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+// Large payloads over a Unix socket without copying them through it.
+//
+// The sender writes the payload into a memfd, seals it so it can no longer
+// change size or contents, and sends the descriptor with SCM_RIGHTS. The
+// receiver checks the seals and maps the file read-only: the bytes are shared
+// with the sender's page cache instead of being copied through the socket
+// buffer BUFFER_SIZE bytes at a time. Small payloads are cheaper inline; the
+// caller picks a threshold.
+//
+// Requires _GNU_SOURCE for memfd_create() and the F_*SEAL* constants.
+
+#define MEMFD_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)
+#define MEMFD_DEFAULT_THRESHOLD (64 * 1024)
+
+/**
+ * @brief Creates a sealed memfd holding a copy of data.
+ * Returns the descriptor, or -1 with errno set.
+ */
+static inline int memfd_from_buffer(const char* name, const void* data, size_t len)
+{
+    int fd = memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1)
+        return -1;
+
+    // write() rather than a shared mapping: F_SEAL_WRITE is refused while a
+    // writable shared mapping of the file exists.
+    const char* p = data;
+    size_t left = len;
+    while (left > 0)
+    {
+        ssize_t n = write(fd, p, left);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            close(fd);
+            return -1;
+        }
+        p += n;
+        left -= n;
+    }
+
+    if (fcntl(fd, F_ADD_SEALS, MEMFD_SEALS) == -1)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Sends len bytes of data with fd attached as SCM_RIGHTS.
+ * len must be at least 1: a stream socket cannot carry ancillary data alone.
+ * Returns 0 on success, -1 on error.
+ */
+static inline int send_fd(int sock, int fd, const void* data, size_t len)
+{
+    struct iovec iov = { (void*)data, len };
+    union
+    {
+        struct cmsghdr _header;
+        char _buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control._buf;
+    msg.msg_controllen = sizeof(control._buf);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    return sendmsg(sock, &msg, 0) == (ssize_t)len ? 0 : -1;
+}
+
+/**
+ * @brief read() that also picks up a descriptor sent with send_fd().
+ * *fd is set to the received descriptor (close-on-exec) or -1 if none came
+ * with these bytes. Returns what recvmsg() returns.
+ */
+static inline ssize_t recv_with_fd(int sock, void* buf, size_t len, int* fd)
+{
+    struct iovec iov = { buf, len };
+    union
+    {
+        struct cmsghdr _header;
+        char _buf[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control._buf;
+    msg.msg_controllen = sizeof(control._buf);
+
+    *fd = -1;
+    ssize_t n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    if (n <= 0)
+        return n;
+
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    return n;
+}
+
+/**
+ * @brief Maps a received memfd read-only after checking that the sender can no
+ * longer resize or modify it (otherwise it could truncate the file under us
+ * and turn our reads into SIGBUS). Returns the mapping and its length, or
+ * MAP_FAILED with errno set. An empty file maps to NULL with *len == 0.
+ */
+static inline const void* map_sealed_memfd(int fd, size_t* len)
+{
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals == -1 || (seals & (F_SEAL_SHRINK | F_SEAL_WRITE)) != (F_SEAL_SHRINK | F_SEAL_WRITE))
+    {
+        errno = EPERM;
+        return MAP_FAILED;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+        return MAP_FAILED;
+    *len = st.st_size;
+    if (*len == 0)
+        return NULL;
+    return mmap(NULL, *len, PROT_READ, MAP_SHARED, fd, 0);
+}
+
+/**
+ * @brief Cheap checksum both ends compute to show the payload arrived intact.
+ */
+static inline uint32_t payload_checksum(const void* data, size_t len)
+{
+    const unsigned char* p = data;
+    uint32_t a = 1, b = 0; // Adler-32 without the modulo on every byte
+    for (size_t i = 0; i < len; i++)
+    {
+        a += p[i];
+        b += a;
+        if ((i & 4095) == 4095)
+        {
+            a %= 65521;
+            b %= 65521;
+        }
+    }
+    return ((b % 65521) << 16) | (a % 65521);
+}
+
+#endif // FD_PASSING_H
@@ -0,0 +1,132 @@
+#ifndef MESSAGE_SOCKET_H
+#define MESSAGE_SOCKET_H
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "constants.h"
+
+// Socket types that keep message boundaries, and batching for them.
+//
+// SOCK_STREAM is a byte stream: two writes can arrive as one read, or one write
+// as two reads. SOCK_SEQPACKET (connected) and SOCK_DGRAM (connectionless)
+// deliver every message whole and separately, so they need no framing. In
+// exchange each message is its own recvmsg()/sendmsg(); recvmmsg() and
+// sendmmsg() move up to MMSG_BATCH of them per syscall instead.
+//
+// Requires _GNU_SOURCE for recvmmsg()/sendmmsg().
+
+#define MMSG_BATCH 64
+
+/**
+ * @brief Parses "stream", "seqpacket" or "dgram". Returns the SOCK_* type or -1.
+ */
+static inline int socket_type_from_name(const char* name)
+{
+    if (strcmp(name, "stream") == 0)
+        return SOCK_STREAM;
+    if (strcmp(name, "seqpacket") == 0)
+        return SOCK_SEQPACKET;
+    if (strcmp(name, "dgram") == 0)
+        return SOCK_DGRAM;
+    return -1;
+}
+
+static inline const char* socket_type_name(int type)
+{
+    return type == SOCK_SEQPACKET ? "seqpacket" : type == SOCK_DGRAM ? "dgram" : "stream";
+}
+
+/**
+ * @brief Gives a datagram client an address of its own (an autobound abstract
+ * name), without which the server has nowhere to send the reply.
+ */
+static inline int dgram_autobind(int sock)
+{
+    struct sockaddr_un addr = { 0 };
+    addr.sun_family = AF_UNIX;
+    return bind(sock, (struct sockaddr*)&addr, sizeof(sa_family_t));
+}
+
+typedef struct
+{
+    struct mmsghdr _hdrs[MMSG_BATCH];
+    struct iovec _iovs[MMSG_BATCH];
+    struct sockaddr_un _addrs[MMSG_BATCH]; // Senders, for replies on an unconnected socket
+    char _bufs[MMSG_BATCH][BUFFER_SIZE];
+} mmsg_batch_t;
+
+/**
+ * @brief Receives between 1 and MMSG_BATCH messages: blocks for the first,
+ * then takes whatever else is already queued. Message i is in _bufs[i],
+ * _hdrs[i].msg_len bytes long. Returns the count, or -1 with errno set.
+ */
+static inline int mmsg_batch_recv(int sock, mmsg_batch_t* batch)
+{
+    for (int i = 0; i < MMSG_BATCH; i++)
+    {
+        batch->_iovs[i].iov_base = batch->_bufs[i];
+        batch->_iovs[i].iov_len = BUFFER_SIZE;
+        memset(&batch->_hdrs[i].msg_hdr, 0, sizeof(struct msghdr));
+        batch->_hdrs[i].msg_hdr.msg_iov = &batch->_iovs[i];
+        batch->_hdrs[i].msg_hdr.msg_iovlen = 1;
+        batch->_hdrs[i].msg_hdr.msg_name = &batch->_addrs[i];
+        batch->_hdrs[i].msg_hdr.msg_namelen = sizeof(batch->_addrs[i]);
+    }
+    int n;
+    do
+        n = recvmmsg(sock, batch->_hdrs, MMSG_BATCH, MSG_WAITFORONE, NULL);
+    while (n == -1 && errno == EINTR);
+    return n;
+}
+
+/**
+ * @brief Sends the first count received messages back where they came from.
+ * connected says whether sock has a peer (seqpacket) or replies go to each
+ * sender's address (dgram); on an unconnected socket, messages from senders
+ * without an address are dropped, since there is nowhere to send them. A
+ * message the kernel refuses (e.g. its sender has gone away) is skipped
+ * rather than failing the rest. Returns the number of sendmmsg() calls made,
+ * or -1 if the socket itself failed.
+ */
+static inline int mmsg_batch_echo(int sock, mmsg_batch_t* batch, int count, int connected)
+{
+    int kept = 0;
+    for (int i = 0; i < count; i++)
+    {
+        batch->_iovs[i].iov_len = batch->_hdrs[i].msg_len;
+        if (batch->_hdrs[i].msg_hdr.msg_namelen <= sizeof(sa_family_t))
+        {
+            if (!connected)
+                continue; // An unbound datagram sender
+            batch->_hdrs[i].msg_hdr.msg_name = NULL;
+            batch->_hdrs[i].msg_hdr.msg_namelen = 0;
+        }
+        if (kept != i)
+            batch->_hdrs[kept] = batch->_hdrs[i]; // Still points at _iovs[i] and _addrs[i]
+        kept++;
+    }
+
+    int calls = 0;
+    for (int sent = 0; sent < kept;)
+    {
+        int n = sendmmsg(sock, batch->_hdrs + sent, kept - sent, 0);
+        calls++;
+        if (n > 0)
+            sent += n;
+        else if (n == 0)
+            sent++; // Not expected, but never retry the same message forever
+        else if (errno == EINTR)
+            continue;
+        else if (errno == ECONNREFUSED || errno == ENOENT || errno == EDESTADDRREQ || errno == ENOTCONN)
+            sent++; // Nobody to reply to
+        else
+            return -1;
+    }
+    return calls;
+}
+
+#endif // MESSAGE_SOCKET_H
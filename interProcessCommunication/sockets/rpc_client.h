@@ -0,0 +1,258 @@
+#ifndef RPC_CLIENT_H
+#define RPC_CLIENT_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "rpc_protocol.h"
+
+// Client side of the pipelined RPC protocol.
+//
+// rpc_submit() queues a request and returns at once; rpc_poll() sends what is
+// queued, reads whatever replies have arrived and calls each request's
+// callback. Up to _window requests may be in flight, so one connection is no
+// longer limited to one request per round trip. Replies are matched by id, in
+// whatever order they come.
+//
+// The socket is made non-blocking and every wait goes through poll() on both
+// directions: blocking in write() while the server is blocked writing replies
+// to us would deadlock both.
+
+#define RPC_CLIENT_BUFFER_SIZE (4 * CONN_BUFFER_SIZE)
+
+/**
+ * @brief Called once per reply. payload is only valid during the call.
+ */
+typedef void (*rpc_callback_t)(void* ctx, uint32_t id, uint16_t status, const char* payload, size_t len);
+
+typedef struct
+{
+    uint32_t _id; // 0 while the slot is free
+    rpc_callback_t _callback;
+    void* _ctx;
+    uint32_t _next_free;
+} rpc_pending_t;
+
+typedef struct
+{
+    int _fd;
+    uint32_t _window;      // Most requests in flight at once
+    uint32_t _in_flight;
+    uint32_t _generation;  // High bits of the next id, so stale ids never match
+    uint32_t _free;        // First free _pending slot; _window when none
+    rpc_pending_t* _pending;
+
+    // Requests submitted but not yet accepted by the socket.
+    char _wbuf[RPC_CLIENT_BUFFER_SIZE];
+    size_t _wlen;
+    size_t _woff;
+
+    // Reply bytes not yet parsed.
+    char _rbuf[RPC_CLIENT_BUFFER_SIZE];
+    size_t _rlen;
+
+    unsigned long _syscalls;
+} rpc_client_t;
+
+#define RPC_MAX_WINDOW (1 << 16) // Slot index in the low 16 bits of an id
+
+/**
+ * @brief Takes over a connected stream socket and makes it non-blocking.
+ * Returns 0, or -1 with errno set if the window is out of range, fcntl()
+ * fails or allocation fails.
+ */
+static inline int rpc_client_init(rpc_client_t* client, int fd, uint32_t window)
+{
+    if (window < 1 || window > RPC_MAX_WINDOW)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+        return -1;
+    client->_fd = fd;
+    client->_window = window;
+    client->_in_flight = 0;
+    client->_generation = 0;
+    client->_wlen = client->_woff = client->_rlen = 0;
+    client->_syscalls = 0;
+    client->_pending = calloc(window, sizeof(rpc_pending_t));
+    if (client->_pending == NULL)
+        return -1;
+    for (uint32_t i = 0; i < window; i++)
+        client->_pending[i]._next_free = i + 1;
+    client->_free = 0;
+    return 0;
+}
+
+static inline void rpc_client_destroy(rpc_client_t* client)
+{
+    free(client->_pending);
+    client->_pending = NULL;
+}
+
+/**
+ * @brief Writes queued requests until done or the socket is full.
+ * Returns 0, or -1 on a socket error.
+ */
+static inline int rpc_flush(rpc_client_t* client)
+{
+    while (client->_woff < client->_wlen)
+    {
+        ssize_t n = write(client->_fd, client->_wbuf + client->_woff, client->_wlen - client->_woff);
+        client->_syscalls++;
+        if (n > 0)
+            client->_woff += n;
+        else if (errno == EAGAIN)
+            break;
+        else if (errno != EINTR)
+            return -1;
+    }
+    if (client->_woff == client->_wlen)
+        client->_woff = client->_wlen = 0;
+    return 0;
+}
+
+/**
+ * @brief Queues a request. It is sent by the next rpc_poll() (or by this call
+ * if the send buffer is full). Returns the request id, or 0 with errno EAGAIN
+ * when the window or the send buffer is full (call rpc_poll() and retry),
+ * EMSGSIZE for a payload over RPC_MAX_PAYLOAD, or another errno on a socket
+ * error.
+ */
+static inline uint32_t rpc_submit(rpc_client_t* client, uint16_t op, const void* payload, uint32_t len,
+                                  rpc_callback_t callback, void* ctx)
+{
+    if (len > RPC_MAX_PAYLOAD)
+    {
+        errno = EMSGSIZE;
+        return 0;
+    }
+    if (client->_in_flight == client->_window)
+    {
+        errno = EAGAIN;
+        return 0;
+    }
+    if (client->_wlen + RPC_HEADER_SIZE + len > RPC_CLIENT_BUFFER_SIZE)
+    {
+        if (rpc_flush(client) == -1)
+            return 0;
+        if (client->_wlen + RPC_HEADER_SIZE + len > RPC_CLIENT_BUFFER_SIZE)
+        {
+            errno = EAGAIN;
+            return 0;
+        }
+    }
+
+    uint32_t slot = client->_free;
+    rpc_pending_t* pending = &client->_pending[slot];
+    client->_free = pending->_next_free;
+    client->_in_flight++;
+
+    // Never 0: the generation starts at 1 and wraps past 0.
+    if (++client->_generation == 1u << 16)
+        client->_generation = 1;
+    pending->_id = (client->_generation << 16) | slot;
+    pending->_callback = callback;
+    pending->_ctx = ctx;
+
+    rpc_header_t header = { len, pending->_id, op, 0 };
+    memcpy(client->_wbuf + client->_wlen, &header, RPC_HEADER_SIZE);
+    memcpy(client->_wbuf + client->_wlen + RPC_HEADER_SIZE, payload, len);
+    client->_wlen += RPC_HEADER_SIZE + len;
+    return pending->_id;
+}
+
+/**
+ * @brief Dispatches every complete reply in _rbuf. Returns the number
+ * dispatched, or -1 for a reply that matches no request in flight.
+ */
+static inline int rpc_dispatch(rpc_client_t* client)
+{
+    int completed = 0;
+    size_t off = 0;
+    while (client->_rlen - off >= RPC_HEADER_SIZE)
+    {
+        rpc_header_t reply;
+        memcpy(&reply, client->_rbuf + off, RPC_HEADER_SIZE);
+        if (client->_rlen - off < RPC_HEADER_SIZE + reply._length)
+            break;
+
+        uint32_t slot = reply._id & (RPC_MAX_WINDOW - 1);
+        if (slot >= client->_window || client->_pending[slot]._id != reply._id || reply._id == 0)
+        {
+            errno = EPROTO;
+            return -1;
+        }
+        rpc_pending_t* pending = &client->_pending[slot];
+        rpc_callback_t callback = pending->_callback;
+        void* ctx = pending->_ctx;
+
+        // Free the slot before the callback so it can submit the next request.
+        pending->_id = 0;
+        pending->_next_free = client->_free;
+        client->_free = slot;
+        client->_in_flight--;
+
+        if (callback)
+            callback(ctx, reply._id, reply._status, client->_rbuf + off + RPC_HEADER_SIZE, reply._length);
+        off += RPC_HEADER_SIZE + reply._length;
+        completed++;
+    }
+    memmove(client->_rbuf, client->_rbuf + off, client->_rlen - off);
+    client->_rlen -= off;
+    return completed;
+}
+
+/**
+ * @brief Sends queued requests and dispatches the replies that have arrived.
+ * With wait set, blocks until at least one reply is dispatched (if any are
+ * in flight). Returns the number of callbacks made, or -1 on error (errno
+ * EPROTO for a reply that matches no request, ECONNRESET if the server went away).
+ */
+static inline int rpc_poll(rpc_client_t* client, int wait)
+{
+    int completed = 0;
+    for (;;)
+    {
+        if (rpc_flush(client) == -1)
+            return -1;
+
+        ssize_t n = read(client->_fd, client->_rbuf + client->_rlen, RPC_CLIENT_BUFFER_SIZE - client->_rlen);
+        client->_syscalls++;
+        if (n == 0)
+        {
+            errno = ECONNRESET;
+            return -1;
+        }
+        if (n > 0)
+        {
+            client->_rlen += n;
+            int dispatched = rpc_dispatch(client);
+            if (dispatched == -1)
+                return -1;
+            completed += dispatched;
+            continue; // More may be waiting
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN)
+            return -1;
+
+        // Nothing more to read right now
+        if (!wait || completed > 0 || client->_in_flight == 0)
+            return completed;
+
+        struct pollfd pfd = { client->_fd, POLLIN | (client->_woff < client->_wlen ? POLLOUT : 0), 0 };
+        client->_syscalls++;
+        if (poll(&pfd, 1, -1) == -1 && errno != EINTR)
+            return -1;
+    }
+}
+
+#endif // RPC_CLIENT_H
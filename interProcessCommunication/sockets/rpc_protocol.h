@@ -0,0 +1,36 @@
+#ifndef RPC_PROTOCOL_H
+#define RPC_PROTOCOL_H
+
+#include <stdint.h>
+
+#include "constants.h"
+
+// Wire format of the pipelined RPC protocol (server -m rpc, rpc_client.h).
+//
+// Every request and every reply is a header followed by _length payload bytes.
+// The client picks _id and the server copies it into the reply, so a client
+// can have many requests in flight on one connection and match each reply to
+// its request whatever order the replies come back in.
+//
+// Both ends are on the same host (Unix sockets), so fields are in host byte
+// order.
+
+typedef struct
+{
+    uint32_t _length; // Payload bytes after the header
+    uint32_t _id;     // Chosen by the client, echoed in the reply
+    uint16_t _op;     // RPC_OP_*; a reply carries its request's op
+    uint16_t _status; // RPC_STATUS_* in replies, 0 in requests
+} rpc_header_t;
+
+#define RPC_HEADER_SIZE sizeof(rpc_header_t)
+// A whole frame must fit in the server's per-connection buffers.
+#define RPC_MAX_PAYLOAD (CONN_BUFFER_SIZE - RPC_HEADER_SIZE)
+
+#define RPC_OP_ECHO 1 // Reply with the request's payload
+#define RPC_OP_PING 2 // Reply with no payload
+
+#define RPC_STATUS_OK 0
+#define RPC_STATUS_UNKNOWN_OP 1
+
+#endif // RPC_PROTOCOL_H
@@ -1,4 +1,5 @@
 // server.c
+#define _GNU_SOURCE // memfd seals in fd_passing.h, recvmmsg/sendmmsg
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,22 +7,118 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <signal.h>
+#include <sys/mman.h>
 
 #include "./constants.h"
+#include "./epoll_server.h"
+#include "./server_stats.h"
+#include "./fd_passing.h"
+#include "./message_socket.h"
+
+// Compile with:
+// gcc server.c epoll_server.c -o server -pthread
+//
+// Usage: ./server [-m fork|epoll|rpc] [-t threads] [-p stream|seqpacket|dgram] [-q]
+//   -m fork   one process per connection (default)
+//   -m epoll  non-blocking sockets on edge-triggered epoll, -t event-loop threads
+//   -m rpc    the epoll server speaking the pipelined RPC protocol of
+//             rpc_protocol.h (clients: rpc_client.h, "bench_client -m rpc")
+//   -p        socket type (default stream). seqpacket forks per connection and
+//             dgram serves every client from one loop; both echo each message
+//             as a message, up to MMSG_BATCH per recvmmsg()/sendmmsg()
+//   -q        do not print per-connection and per-message logs (for benchmarks)
+//
+// In fork stream mode a client may also send a large payload as a sealed memfd
+// (client -s); the server maps it read-only and replies with its checksum.
+
+typedef enum
+{
+    MODE_FORK = 0,
+    MODE_EPOLL,
+    MODE_RPC
+} server_mode_t;
+
+int verbose = 1;
+server_mode_t mode = MODE_FORK;
+int socket_type = SOCK_STREAM;
+
+// Shared with the forked children, which count their own reads and writes.
+server_stats_t* stats;
 
 void handle_client(int client_sock);
+void handle_packet_client(int client_sock);
+int handle_memfd_payload(int client_sock, int fd);
+void run_fork_server(int server_sock);
+void run_dgram_server(int server_sock);
 
-int main()
+const char* mode_name(void)
 {
-    int server_sock, client_sock;
-    struct sockaddr_un server_addr, client_addr;
-    socklen_t client_len = sizeof(client_addr);
+    return mode == MODE_RPC ? "rpc" : mode == MODE_EPOLL ? "epoll" : "fork";
+}
+
+void print_stats_and_exit(int sig)
+{
+    server_stats_print(stats, socket_type == SOCK_DGRAM ? "dgram"
+                              : socket_type == SOCK_SEQPACKET ? "seqpacket fork"
+                              : mode_name());
+    unlink(SOCKET_PATH);
+    exit(0);
+}
+
+int main(int argc, char* argv[])
+{
+    int server_sock;
+    struct sockaddr_un server_addr;
+    int threads = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:t:p:q")) != -1)
+    {
+        switch (opt)
+        {
+        case 'm':
+            if (strcmp(optarg, "fork") == 0)
+                mode = MODE_FORK;
+            else if (strcmp(optarg, "epoll") == 0)
+                mode = MODE_EPOLL;
+            else if (strcmp(optarg, "rpc") == 0)
+                mode = MODE_RPC;
+            else
+            {
+                fprintf(stderr, "Unknown mode '%s'\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'p':
+            socket_type = socket_type_from_name(optarg);
+            if (socket_type == -1)
+            {
+                fprintf(stderr, "Unknown socket type '%s'\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'q':
+            verbose = 0;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-m fork|epoll|rpc] [-t threads] [-p stream|seqpacket|dgram] [-q]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (mode != MODE_FORK && socket_type != SOCK_STREAM)
+    {
+        fprintf(stderr, "The epoll and rpc servers only use stream sockets.\n");
+        exit(EXIT_FAILURE);
+    }
 
     // Unlink any old socket file
     unlink(SOCKET_PATH);
 
     // 1. Create a UNIX domain socket
-    server_sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    server_sock = socket(AF_UNIX, socket_type, 0);
     if (server_sock == -1)
     {
         perror("socket");
@@ -40,36 +137,82 @@ int main()
         exit(EXIT_FAILURE);
     }
 
-    // 3. Listen for incoming connections
-    if (listen(server_sock, 5) == -1)
+    // 3. Listen for incoming connections (datagram sockets have none)
+    if (socket_type != SOCK_DGRAM && listen(server_sock, LISTEN_BACKLOG) == -1)
     {
         perror("listen");
         close(server_sock);
         exit(EXIT_FAILURE);
     }
 
-    printf("Server is listening on %s\n", SOCKET_PATH);
+    printf("Server is listening on %s (%s mode, %s)\n", SOCKET_PATH, mode_name(), socket_type_name(socket_type));
+
+    // A client that disconnects mid-write must not kill the server.
+    signal(SIGPIPE, SIG_IGN);
+
+    stats = mmap(NULL, sizeof(server_stats_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (stats == MAP_FAILED)
+    {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    signal(SIGINT, print_stats_and_exit);
+    signal(SIGTERM, print_stats_and_exit);
+
+    // 4. Serve connections
+    if (socket_type == SOCK_DGRAM)
+        run_dgram_server(server_sock);
+    else if (mode != MODE_FORK)
+        run_epoll_server(server_sock, threads, mode == MODE_RPC ? rpc_protocol : echo_protocol, stats, verbose);
+    else
+        run_fork_server(server_sock);
+
+    // Cleanup (only reached if the server loop fails)
+    close(server_sock);
+    unlink(SOCKET_PATH);
+
+    return 0;
+}
+
+// Accepts connections in a loop and forks a process for each one
+void run_fork_server(int server_sock)
+{
+    int client_sock;
+    struct sockaddr_un client_addr;
+    socklen_t client_len = sizeof(client_addr);
 
     // Handle zombie processes
     signal(SIGCHLD, SIG_IGN);
 
-    // 4. Accept connections in a loop
     while (1)
     {
         client_sock = accept(server_sock, (struct sockaddr *)&client_addr, &client_len);
+        stats_add(&stats->_syscalls, 1);
         if (client_sock == -1)
         {
             perror("accept");
             continue; // Continue to the next connection attempt
         }
 
-        printf("Server: Accepted a new connection.\n");
+        if (verbose)
+            printf("Server: Accepted a new connection.\n");
+
+        stats_add(&stats->_connections, 1);
+        // fork() in the parent, close() of the client socket in the parent
+        stats_add(&stats->_syscalls, 2);
 
         // 5. Fork a new process to handle the client
+        fflush(stdout); // Or the child repeats whatever the parent still had buffered
         if (fork() == 0)
         { // This is the child process
+            // Children must not print the totals when the terminal's Ctrl+C reaches them.
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
             close(server_sock); // Child doesn't need the listener socket
-            handle_client(client_sock);
+            if (socket_type == SOCK_SEQPACKET)
+                handle_packet_client(client_sock);
+            else
+                handle_client(client_sock);
             exit(EXIT_SUCCESS);
         }
         else
@@ -78,12 +221,6 @@ int main()
             close(client_sock); // Parent doesn't need the client socket
         }
     }
-
-    // Cleanup (this part is unreachable in this simple example)
-    close(server_sock);
-    unlink(SOCKET_PATH);
-
-    return 0;
 }
 
 // This function handles communication with a single client
@@ -91,11 +228,26 @@ void handle_client(int client_sock)
 {
     char buffer[BUFFER_SIZE];
     int n;
+    int fd;
 
-    while ((n = read(client_sock, buffer, sizeof(buffer) - 1)) > 0)
+    // recvmsg() instead of read() so descriptors sent with SCM_RIGHTS are picked up
+    while ((n = recv_with_fd(client_sock, buffer, sizeof(buffer) - 1, &fd)) > 0)
     {
+        // This read and the write below
+        stats_add(&stats->_syscalls, 2);
+        stats_add(&stats->_requests, 1);
+
+        if (fd != -1)
+        {
+            // The bytes that came with the descriptor are only a marker
+            if (handle_memfd_payload(client_sock, fd) == -1)
+                break;
+            continue;
+        }
+
         buffer[n] = '\0';
-        printf("Server received: %s\n", buffer);
+        if (verbose)
+            printf("Server received: %s\n", buffer);
 
         // Echo the message back to the client
         if (write(client_sock, buffer, n) == -1)
@@ -107,10 +259,128 @@ void handle_client(int client_sock)
 
     if (n == 0)
     {
-        printf("Client disconnected.\n");
+        if (verbose)
+            printf("Client disconnected.\n");
     } else if (n == -1) {
         perror("read");
     }
 
+    // The final read and the close
+    stats_add(&stats->_syscalls, 2);
+    close(client_sock);
+}
+
+// Echoes the messages of one seqpacket connection, a batch at a time
+void handle_packet_client(int client_sock)
+{
+    mmsg_batch_t* batch = malloc(sizeof(mmsg_batch_t));
+    int n = 0;
+
+    while (batch != NULL && (n = mmsg_batch_recv(client_sock, batch)) > 0)
+    {
+        // A closed connection reads as an empty message; echo what came before it
+        int count = 0;
+        while (count < n && batch->_hdrs[count].msg_len > 0)
+            count++;
+
+        stats_add(&stats->_requests, count);
+        if (verbose)
+            for (int i = 0; i < count; i++)
+                printf("Server received: %.*s\n", (int)batch->_hdrs[i].msg_len, batch->_bufs[i]);
+
+        int calls = count > 0 ? mmsg_batch_echo(client_sock, batch, count, 1) : 0;
+        stats_add(&stats->_syscalls, 1 + (calls > 0 ? calls : 0));
+        if (calls == -1)
+        {
+            perror("sendmmsg");
+            break;
+        }
+        if (count < n)
+        {
+            n = 0;
+            break;
+        }
+    }
+
+    if (n == 0)
+    {
+        if (verbose)
+            printf("Client disconnected.\n");
+    } else if (n == -1) {
+        perror("recvmmsg");
+    }
+
+    // The final recvmmsg and the close
+    stats_add(&stats->_syscalls, 2);
+    free(batch);
     close(client_sock);
 }
+
+// Serves every datagram client from one loop: no connections and no fork,
+// each reply goes to the address its request came from
+void run_dgram_server(int server_sock)
+{
+    mmsg_batch_t* batch = malloc(sizeof(mmsg_batch_t));
+    if (batch == NULL)
+    {
+        perror("malloc");
+        return;
+    }
+
+    while (1)
+    {
+        int n = mmsg_batch_recv(server_sock, batch);
+        stats_add(&stats->_syscalls, 1);
+        if (n == -1)
+        {
+            perror("recvmmsg");
+            continue;
+        }
+
+        stats_add(&stats->_requests, n);
+        if (verbose)
+            for (int i = 0; i < n; i++)
+                printf("Server received: %.*s\n", (int)batch->_hdrs[i].msg_len, batch->_bufs[i]);
+
+        // Blocks while a client's receive queue is full: a datagram server
+        // could drop instead, but then a benchmark client would wait forever.
+        int calls = mmsg_batch_echo(server_sock, batch, n, 0);
+        if (calls == -1)
+            perror("sendmmsg");
+        else
+            stats_add(&stats->_syscalls, calls);
+    }
+}
+
+// Maps a payload passed as a sealed memfd and replies with its size and checksum
+int handle_memfd_payload(int client_sock, int fd)
+{
+    char reply[BUFFER_SIZE];
+    size_t len;
+
+    // fcntl(F_GET_SEALS), fstat, mmap, munmap and close
+    stats_add(&stats->_syscalls, 5);
+    const void* data = map_sealed_memfd(fd, &len);
+    if (data == MAP_FAILED)
+    {
+        perror("map_sealed_memfd");
+        close(fd);
+        return -1;
+    }
+
+    int reply_len = snprintf(reply, sizeof(reply), "memfd payload: %zu bytes, checksum %08x",
+                             len, payload_checksum(data, len));
+    if (verbose)
+        printf("Server received %s\n", reply);
+
+    if (data != NULL)
+        munmap((void*)data, len);
+    close(fd);
+
+    if (write(client_sock, reply, reply_len) == -1)
+    {
+        perror("write");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef SERVER_STATS_H
+#define SERVER_STATS_H
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+// Counters every server mode keeps so the designs can be compared by
+// syscalls per request. They are printed when the server is stopped (Ctrl+C).
+// A "request" is one RPC frame answered in rpc mode, and one message in the
+// seqpacket and dgram modes. In the stream echo modes it is one read/recv
+// that returned data (for epoll, one batch of input echoed); with the
+// benchmark client's small messages that is one message.
+typedef struct
+{
+    _Atomic unsigned long _syscalls;
+    _Atomic unsigned long _requests;
+    _Atomic unsigned long _connections;
+} server_stats_t;
+
+static inline void stats_add(_Atomic unsigned long* counter, unsigned long n)
+{
+    atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+}
+
+static inline void server_stats_print(server_stats_t* stats, const char* mode)
+{
+    unsigned long syscalls = atomic_load(&stats->_syscalls);
+    unsigned long requests = atomic_load(&stats->_requests);
+    printf("\nServer (%s): %lu connections, %lu requests, %lu syscalls, %.2f syscalls/request\n",
+           mode, atomic_load(&stats->_connections), requests, syscalls,
+           requests ? (double)syscalls / requests : 0.0);
+}
+
+#endif // SERVER_STATS_H
@@ -0,0 +1,580 @@
+// uring_server.c
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "./constants.h"
+#include "./server_stats.h"
+
+// Compile with:
+// gcc -O2 uring_server.c -o uring_server
+//
+// Usage: ./uring_server [-q]
+//
+// The echo server from server.c driven entirely by io_uring (Linux 6.0+), talking
+// to the raw syscalls so no liburing is needed:
+//   - one multishot accept keeps producing a completion per new connection
+//   - one multishot recv per connection picks its buffers from a provided
+//     buffer ring, so no buffer is tied up by an idle connection
+//   - the replies for a connection are queued as a chain of linked sends
+//     (IOSQE_IO_LINK), which the kernel runs in order
+// All of this is submitted and reaped by a single io_uring_enter() per loop
+// iteration, however many connections were active. Stop with Ctrl+C to print
+// the syscalls/request figure for comparison with "./server -m fork|epoll".
+
+#define RING_ENTRIES 4096
+#define BUFFER_GROUP_ID 1
+#define BUFFER_COUNT 2048 // Must be a power of two (buffer ring size)
+#define BUFFER_LEN 4096
+#define MAX_CONNECTIONS 65536 // Connections are indexed by fd
+
+// user_data layout: operation in the top byte, buffer id, then the fd.
+enum { OP_ACCEPT = 1, OP_RECV, OP_SEND, OP_CLOSE };
+#define MAKE_USER_DATA(op, bid, fd) (((uint64_t)(op) << 56) | ((uint64_t)(bid) << 32) | (uint32_t)(fd))
+#define USER_DATA_OP(ud) ((int)((ud) >> 56))
+#define USER_DATA_BID(ud) ((int)(((ud) >> 32) & 0xffff))
+#define USER_DATA_FD(ud) ((int)(uint32_t)(ud))
+
+typedef struct
+{
+    int _fd;
+    // Submission queue (shared with the kernel)
+    _Atomic unsigned* _sq_head;
+    _Atomic unsigned* _sq_tail;
+    unsigned _sq_mask;
+    unsigned _sq_entries;
+    unsigned* _sq_array;
+    struct io_uring_sqe* _sqes;
+    unsigned _sqe_tail;      // Our tail: SQEs prepared so far
+    unsigned _sqe_submitted; // How many of them were handed to io_uring_enter()
+    // Completion queue
+    _Atomic unsigned* _cq_head;
+    _Atomic unsigned* _cq_tail;
+    unsigned _cq_mask;
+    struct io_uring_cqe* _cqes;
+} uring_t;
+
+typedef struct
+{
+    int _open;
+    int _recv_armed; // A multishot recv is outstanding
+    int _closing;    // EOF or error seen; close once nothing is outstanding
+    int _failed;     // A send failed; drop whatever is still pending
+    int _inflight;   // Sends submitted and not yet completed
+    int _pending_head, _pending_tail; // Received buffers waiting to be sent back
+    int _dirty;      // On the dirty list: has pending buffers to flush
+    int _next_dirty;
+    int _parked;     // Recv ended with ENOBUFS; waits on the parked list for a buffer
+    int _next_parked;
+} uring_conn_t;
+
+uring_t ring;
+struct io_uring_buf_ring* buf_ring;
+char* buffers;
+unsigned short buf_ring_tail;
+int buf_len[BUFFER_COUNT];  // Bytes received into each buffer
+int buf_next[BUFFER_COUNT]; // Per-connection pending lists are linked through here
+uring_conn_t* conns;
+int dirty_head = -1;
+int parked_head = -1, parked_tail = -1; // FIFO, so every parked connection gets its turn
+int buffers_returned;                   // Since the last publish_buffers()
+int server_sock = -1;
+int verbose = 1;
+server_stats_t stats;
+
+void print_stats_and_exit(int sig)
+{
+    server_stats_print(&stats, "io_uring");
+    unlink(SOCKET_PATH);
+    exit(0);
+}
+
+// --- Ring setup ---
+
+static int uring_setup(uring_t* r, unsigned entries)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    // Only this thread submits, and completions are processed when we ask for
+    // them, which spares the kernel from interrupting us with task work.
+    p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    r->_fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (r->_fd == -1 && errno == EINVAL)
+    {
+        memset(&p, 0, sizeof(p));
+        r->_fd = syscall(__NR_io_uring_setup, entries, &p);
+    }
+    if (r->_fd == -1)
+        return -1;
+
+    size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        sq_size = cq_size = (sq_size > cq_size ? sq_size : cq_size);
+
+    char* sq = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->_fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED)
+        return -1;
+    char* cq = sq;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        cq = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->_fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED)
+            return -1;
+    }
+    r->_sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, r->_fd, IORING_OFF_SQES);
+    if (r->_sqes == MAP_FAILED)
+        return -1;
+
+    r->_sq_head = (_Atomic unsigned*)(sq + p.sq_off.head);
+    r->_sq_tail = (_Atomic unsigned*)(sq + p.sq_off.tail);
+    r->_sq_mask = *(unsigned*)(sq + p.sq_off.ring_mask);
+    r->_sq_entries = p.sq_entries;
+    r->_sq_array = (unsigned*)(sq + p.sq_off.array);
+    r->_sqe_tail = r->_sqe_submitted = atomic_load_explicit(r->_sq_tail, memory_order_relaxed);
+
+    r->_cq_head = (_Atomic unsigned*)(cq + p.cq_off.head);
+    r->_cq_tail = (_Atomic unsigned*)(cq + p.cq_off.tail);
+    r->_cq_mask = *(unsigned*)(cq + p.cq_off.ring_mask);
+    r->_cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    return 0;
+}
+
+/**
+ * @brief Publishes the prepared SQEs and optionally waits for completions.
+ * This is the only syscall in the steady-state loop.
+ */
+static int uring_submit_and_wait(uring_t* r, unsigned wait_nr)
+{
+    unsigned to_submit = r->_sqe_tail - r->_sqe_submitted;
+    // Release: the SQE contents must be visible before the kernel sees the new tail.
+    atomic_store_explicit(r->_sq_tail, r->_sqe_tail, memory_order_release);
+
+    int ret;
+    do
+    {
+        ret = syscall(__NR_io_uring_enter, r->_fd, to_submit, wait_nr, IORING_ENTER_GETEVENTS, NULL, 0);
+        stats_add(&stats._syscalls, 1);
+    } while (ret == -1 && errno == EINTR);
+
+    if (ret >= 0)
+        r->_sqe_submitted += ret;
+    return ret;
+}
+
+static unsigned uring_sq_space(uring_t* r)
+{
+    return r->_sq_entries - (r->_sqe_tail - atomic_load_explicit(r->_sq_head, memory_order_acquire));
+}
+
+static struct io_uring_sqe* uring_get_sqe(uring_t* r)
+{
+    if (uring_sq_space(r) == 0)
+        uring_submit_and_wait(r, 0);
+
+    unsigned index = r->_sqe_tail & r->_sq_mask;
+    struct io_uring_sqe* sqe = &r->_sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    r->_sq_array[index] = index;
+    r->_sqe_tail++;
+    return sqe;
+}
+
+/**
+ * @brief Registers BUFFER_COUNT buffers of BUFFER_LEN bytes as buffer group
+ * BUFFER_GROUP_ID. Multishot recv takes one from the ring per completion and
+ * we put it back once the echo of its contents has been sent.
+ */
+static int setup_buffer_ring(void)
+{
+    size_t ring_size = BUFFER_COUNT * sizeof(struct io_uring_buf);
+    buf_ring = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    buffers = mmap(NULL, (size_t)BUFFER_COUNT * BUFFER_LEN, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf_ring == MAP_FAILED || buffers == MAP_FAILED)
+        return -1;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)buf_ring;
+    reg.ring_entries = BUFFER_COUNT;
+    reg.bgid = BUFFER_GROUP_ID;
+    if (syscall(__NR_io_uring_register, ring._fd, IORING_REGISTER_PBUF_RING, &reg, 1) == -1)
+        return -1;
+
+    for (int bid = 0; bid < BUFFER_COUNT; ++bid)
+    {
+        struct io_uring_buf* buf = &buf_ring->bufs[buf_ring_tail++ & (BUFFER_COUNT - 1)];
+        buf->addr = (uint64_t)(uintptr_t)(buffers + (size_t)bid * BUFFER_LEN);
+        buf->len = BUFFER_LEN;
+        buf->bid = bid;
+    }
+    atomic_store_explicit((_Atomic unsigned short*)&buf_ring->tail, buf_ring_tail, memory_order_release);
+    return 0;
+}
+
+/**
+ * @brief Hands a buffer back to the kernel. Published in bulk by publish_buffers().
+ */
+static void recycle_buffer(int bid)
+{
+    struct io_uring_buf* buf = &buf_ring->bufs[buf_ring_tail++ & (BUFFER_COUNT - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(buffers + (size_t)bid * BUFFER_LEN);
+    buf->len = BUFFER_LEN;
+    buf->bid = bid;
+    buffers_returned++;
+}
+
+static void publish_buffers(void)
+{
+    atomic_store_explicit((_Atomic unsigned short*)&buf_ring->tail, buf_ring_tail, memory_order_release);
+}
+
+// --- Operations ---
+
+static void arm_accept(void)
+{
+    struct io_uring_sqe* sqe = uring_get_sqe(&ring);
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = server_sock;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = MAKE_USER_DATA(OP_ACCEPT, 0, server_sock);
+}
+
+static void arm_recv(int fd)
+{
+    struct io_uring_sqe* sqe = uring_get_sqe(&ring);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP_ID;
+    sqe->user_data = MAKE_USER_DATA(OP_RECV, 0, fd);
+    conns[fd]._recv_armed = 1;
+}
+
+static void submit_close(int fd)
+{
+    struct io_uring_sqe* sqe = uring_get_sqe(&ring);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+    sqe->user_data = MAKE_USER_DATA(OP_CLOSE, 0, fd);
+    conns[fd]._open = 0;
+}
+
+static void mark_dirty(int fd)
+{
+    if (!conns[fd]._dirty)
+    {
+        conns[fd]._dirty = 1;
+        conns[fd]._next_dirty = dirty_head;
+        dirty_head = fd;
+    }
+}
+
+/**
+ * @brief Closes the connection once no recv or send refers to it any more.
+ * A parked connection is still on the parked list, so it waits to be unparked.
+ */
+static void maybe_close(int fd)
+{
+    uring_conn_t* c = &conns[fd];
+    if (c->_open && c->_closing && !c->_recv_armed && !c->_parked && c->_inflight == 0 && c->_pending_head == -1)
+        submit_close(fd);
+}
+
+static void park(int fd)
+{
+    conns[fd]._parked = 1;
+    conns[fd]._next_parked = -1;
+    if (parked_tail == -1)
+        parked_head = fd;
+    else
+        conns[parked_tail]._next_parked = fd;
+    parked_tail = fd;
+}
+
+/**
+ * @brief Re-arms up to count parked connections, oldest first. Called once the
+ * returned buffers are published, so each re-armed recv has one to take; if
+ * another connection takes it first, the recv parks again and waits for the
+ * next send completion rather than spinning.
+ */
+static void unpark(int count)
+{
+    while (count-- > 0 && parked_head != -1)
+    {
+        int fd = parked_head;
+        uring_conn_t* c = &conns[fd];
+        parked_head = c->_next_parked;
+        if (parked_head == -1)
+            parked_tail = -1;
+        c->_parked = 0;
+        if (c->_closing)
+            maybe_close(fd);
+        else
+            arm_recv(fd);
+    }
+}
+
+/**
+ * @brief Submits a connection's pending replies as one chain of linked sends.
+ * Only one chain per connection is in flight at a time, so replies can never
+ * overtake each other.
+ */
+static void flush_connection(int fd)
+{
+    uring_conn_t* c = &conns[fd];
+    if (c->_inflight > 0 || c->_pending_head == -1)
+        return;
+
+    int length = 0;
+    for (int bid = c->_pending_head; bid != -1; bid = buf_next[bid])
+        length++;
+    // A chain must be submitted in one io_uring_enter(), so make room first.
+    if (uring_sq_space(&ring) < (unsigned)length)
+        uring_submit_and_wait(&ring, 0);
+
+    for (int bid = c->_pending_head; bid != -1; bid = buf_next[bid])
+    {
+        struct io_uring_sqe* sqe = uring_get_sqe(&ring);
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t)(uintptr_t)(buffers + (size_t)bid * BUFFER_LEN);
+        sqe->len = buf_len[bid];
+        sqe->msg_flags = MSG_WAITALL; // Retry short sends inside the kernel
+        if (buf_next[bid] != -1)
+            sqe->flags = IOSQE_IO_LINK;
+        sqe->user_data = MAKE_USER_DATA(OP_SEND, bid, fd);
+        c->_inflight++;
+    }
+    c->_pending_head = c->_pending_tail = -1;
+}
+
+// --- Completion handlers ---
+
+static void on_accept(struct io_uring_cqe* cqe)
+{
+    if (!(cqe->flags & IORING_CQE_F_MORE))
+        arm_accept(); // The multishot accept ended; start a new one
+
+    int fd = cqe->res;
+    if (fd < 0)
+    {
+        fprintf(stderr, "accept: %s\n", strerror(-fd));
+        return;
+    }
+    if (fd >= MAX_CONNECTIONS)
+    {
+        close(fd);
+        return;
+    }
+
+    stats_add(&stats._connections, 1);
+    if (verbose)
+        printf("Server: Accepted a new connection.\n");
+
+    conns[fd] = (uring_conn_t){ ._open = 1, ._pending_head = -1, ._pending_tail = -1, ._next_dirty = -1, ._next_parked = -1 };
+    arm_recv(fd);
+}
+
+static void on_recv(struct io_uring_cqe* cqe, int fd)
+{
+    uring_conn_t* c = &conns[fd];
+    int more = cqe->flags & IORING_CQE_F_MORE;
+    if (!more)
+        c->_recv_armed = 0;
+
+    if (cqe->res > 0)
+    {
+        int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        stats_add(&stats._requests, 1);
+        buf_len[bid] = cqe->res;
+        buf_next[bid] = -1;
+        if (c->_pending_tail == -1)
+            c->_pending_head = bid;
+        else
+            buf_next[c->_pending_tail] = bid;
+        c->_pending_tail = bid;
+        mark_dirty(fd);
+
+        if (!more && !c->_closing)
+            arm_recv(fd);
+        return;
+    }
+
+    if (cqe->res == -ENOBUFS)
+    {
+        // Every buffer is waiting on a send. Re-arming now would only fail
+        // again, so wait until on_send() returns one to the ring.
+        if (!more && !c->_closing)
+            park(fd);
+        return;
+    }
+
+    // 0 is EOF, anything else an error
+    if (cqe->res < 0 && cqe->res != -ECONNRESET)
+        fprintf(stderr, "recv: %s\n", strerror(-cqe->res));
+    if (verbose && !c->_closing)
+        printf("Client disconnected.\n");
+    c->_closing = 1;
+    maybe_close(fd);
+}
+
+static void on_send(struct io_uring_cqe* cqe, int fd, int bid)
+{
+    uring_conn_t* c = &conns[fd];
+    recycle_buffer(bid);
+    c->_inflight--;
+
+    if (cqe->res < buf_len[bid] && !c->_failed)
+    {
+        // Peer went away, or a link earlier in the chain failed (-ECANCELED).
+        // Shutting the socket down ends the multishot recv as well.
+        c->_failed = 1;
+        c->_closing = 1;
+        shutdown(fd, SHUT_RDWR);
+        stats_add(&stats._syscalls, 1);
+    }
+
+    if (c->_inflight == 0)
+    {
+        // After EOF the peer may still be reading, so pending replies are still sent.
+        if (c->_pending_head != -1 && !c->_failed)
+            mark_dirty(fd);
+        else
+        {
+            // Nothing will send these any more.
+            for (int b = c->_pending_head; b != -1; b = buf_next[b])
+                recycle_buffer(b);
+            c->_pending_head = c->_pending_tail = -1;
+            maybe_close(fd);
+        }
+    }
+}
+
+static int create_listener(void)
+{
+    struct sockaddr_un server_addr;
+
+    unlink(SOCKET_PATH);
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == -1)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    memset(&server_addr, 0, sizeof(struct sockaddr_un));
+    server_addr.sun_family = AF_UNIX;
+    strncpy(server_addr.sun_path, SOCKET_PATH, sizeof(server_addr.sun_path) - 1);
+
+    if (bind(sock, (struct sockaddr *)&server_addr, sizeof(struct sockaddr_un)) == -1)
+    {
+        perror("bind");
+        close(sock);
+        return -1;
+    }
+    if (listen(sock, LISTEN_BACKLOG) == -1)
+    {
+        perror("listen");
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc == 2 && strcmp(argv[1], "-q") == 0)
+        verbose = 0;
+    else if (argc != 1)
+    {
+        fprintf(stderr, "usage: %s [-q]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    conns = calloc(MAX_CONNECTIONS, sizeof(uring_conn_t));
+    if (conns == NULL)
+    {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+
+    server_sock = create_listener();
+    if (server_sock == -1)
+        exit(EXIT_FAILURE);
+
+    if (uring_setup(&ring, RING_ENTRIES) == -1)
+    {
+        perror("io_uring_setup");
+        exit(EXIT_FAILURE);
+    }
+    if (setup_buffer_ring() == -1)
+    {
+        perror("io_uring_register (buffer ring)");
+        exit(EXIT_FAILURE);
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, print_stats_and_exit);
+    signal(SIGTERM, print_stats_and_exit);
+
+    printf("Server is listening on %s (io_uring mode)\n", SOCKET_PATH);
+    arm_accept();
+
+    while (1)
+    {
+        if (uring_submit_and_wait(&ring, 1) == -1)
+        {
+            perror("io_uring_enter");
+            break;
+        }
+
+        // Reap every completion that is ready.
+        unsigned head = atomic_load_explicit(ring._cq_head, memory_order_relaxed);
+        unsigned tail = atomic_load_explicit(ring._cq_tail, memory_order_acquire);
+        for (; head != tail; ++head)
+        {
+            struct io_uring_cqe* cqe = &ring._cqes[head & ring._cq_mask];
+            uint64_t ud = cqe->user_data;
+            switch (USER_DATA_OP(ud))
+            {
+            case OP_ACCEPT: on_accept(cqe); break;
+            case OP_RECV:   on_recv(cqe, USER_DATA_FD(ud)); break;
+            case OP_SEND:   on_send(cqe, USER_DATA_FD(ud), USER_DATA_BID(ud)); break;
+            case OP_CLOSE:  break;
+            }
+        }
+        atomic_store_explicit(ring._cq_head, head, memory_order_release);
+
+        // Send everything received in this batch, one linked chain per connection.
+        while (dirty_head != -1)
+        {
+            int fd = dirty_head;
+            dirty_head = conns[fd]._next_dirty;
+            conns[fd]._dirty = 0;
+            if (conns[fd]._open && !conns[fd]._failed)
+                flush_connection(fd);
+        }
+        publish_buffers();
+        int returned = buffers_returned;
+        buffers_returned = 0;
+        unpark(returned);
+    }
+
+    close(server_sock);
+    unlink(SOCKET_PATH);
+    return 0;
+}
@@ -0,0 +1,189 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// Thread and memory placement for the benchmarks.
+//
+// How fast two threads hand data to each other depends on where they run:
+// on one CPU they take turns, on SMT siblings they share an L1, on one socket
+// they meet in the last-level cache, across sockets the line crosses the
+// interconnect. Where the shared buffer lives matters too: memory on a remote
+// NUMA node costs every miss an extra hop. These helpers make both explicit.
+//
+// The benchmarks read two environment variables, so every example takes the
+// same settings without new arguments:
+//   BENCH_CPUS=0,2,4-7  thread i is pinned to the i-th CPU of the list (wrapping)
+//   BENCH_NODE=1        shared buffers are moved to NUMA node 1
+//
+// mbind() is called through syscall(), so no libnuma is needed.
+//
+// Include after defining _GNU_SOURCE (for cpu_set_t and pthread_setaffinity_np).
+
+#define AFFINITY_MAX_CPUS 1024
+#define AFFINITY_MAX_NODES 1024
+
+// From <numaif.h>, which ships with libnuma rather than libc.
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1 << 1)
+#endif
+
+typedef struct
+{
+    int _cpus[AFFINITY_MAX_CPUS]; // CPUs threads are pinned to, in thread order
+    int _cpu_count;               // 0: threads are not pinned
+    int _node;                    // -1: buffers stay where first touched
+} bench_affinity_t;
+
+/**
+ * @brief Parses a CPU list in the kernel's format ("0,2,4-7").
+ * Returns the number of CPUs stored, or -1 if the list is malformed.
+ */
+static inline int cpu_list_parse(const char* list, int* cpus, int max)
+{
+    int count = 0;
+    const char* p = list;
+    while (*p != '\0' && *p != '\n')
+    {
+        char* end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end == p || first < 0)
+            return -1;
+        if (*end == '-')
+        {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first)
+                return -1;
+        }
+        for (long cpu = first; cpu <= last && count < max; ++cpu)
+            cpus[count++] = (int)cpu;
+        p = end;
+        if (*p == ',')
+            ++p;
+        else if (*p != '\0' && *p != '\n')
+            return -1;
+    }
+    return count;
+}
+
+/**
+ * @brief Restricts a thread to one CPU. Returns 0, or an errno value.
+ */
+static inline int pin_thread(pthread_t thread, int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+
+/**
+ * @brief Binds the pages covering [addr, addr + len) to a NUMA node, moving
+ * pages already faulted in. The range is widened to whole pages, so
+ * neighbouring data on the same pages moves with it.
+ * Returns 0, or -1 with errno set.
+ */
+static inline int numa_bind_memory(void* addr, size_t len, int node)
+{
+    unsigned long mask[AFFINITY_MAX_NODES / 64] = { 0 };
+    if (node < 0 || node >= AFFINITY_MAX_NODES)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    mask[node / 64] = 1ul << (node % 64);
+
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)addr & ~(page - 1);
+    uintptr_t end = ((uintptr_t)addr + len + page - 1) & ~(page - 1);
+    return (int)syscall(SYS_mbind, start, end - start, MPOL_BIND, mask, AFFINITY_MAX_NODES, MPOL_MF_MOVE);
+}
+
+/**
+ * @brief Reads BENCH_CPUS and BENCH_NODE. Returns 0, or -1 (after printing
+ * why) if either is malformed.
+ */
+static inline int bench_affinity_from_env(bench_affinity_t* a)
+{
+    a->_cpu_count = 0;
+    a->_node = -1;
+
+    const char* cpus = getenv("BENCH_CPUS");
+    if (cpus != NULL && *cpus != '\0')
+    {
+        a->_cpu_count = cpu_list_parse(cpus, a->_cpus, AFFINITY_MAX_CPUS);
+        if (a->_cpu_count <= 0)
+        {
+            fprintf(stderr, "BENCH_CPUS: expected a CPU list such as 0,2,4-7\n");
+            return -1;
+        }
+    }
+    const char* node = getenv("BENCH_NODE");
+    if (node != NULL && *node != '\0')
+    {
+        char* end;
+        a->_node = (int)strtol(node, &end, 10);
+        if (end == node || *end != '\0' || a->_node < 0)
+        {
+            fprintf(stderr, "BENCH_NODE: expected a node number\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Pins the index-th benchmark thread, if BENCH_CPUS was given.
+ */
+static inline void bench_affinity_pin(const bench_affinity_t* a, pthread_t thread, int index)
+{
+    if (a->_cpu_count == 0)
+        return;
+    int cpu = a->_cpus[index % a->_cpu_count];
+    int rc = pin_thread(thread, cpu);
+    if (rc != 0)
+        fprintf(stderr, "pin thread %d to CPU %d: %s\n", index, cpu, strerror(rc));
+}
+
+/**
+ * @brief Moves a shared buffer to the BENCH_NODE node, if one was given.
+ */
+static inline void bench_affinity_place(const bench_affinity_t* a, void* addr, size_t len)
+{
+    if (a->_node >= 0 && numa_bind_memory(addr, len, a->_node) != 0)
+        perror("mbind");
+}
+
+/**
+ * @brief Prints the placement in effect, for the benchmark header.
+ */
+static inline void bench_affinity_print(const bench_affinity_t* a)
+{
+    if (a->_cpu_count == 0 && a->_node < 0)
+        return;
+    printf("affinity:");
+    if (a->_cpu_count > 0)
+    {
+        printf(" cpus");
+        for (int i = 0; i < a->_cpu_count; ++i)
+            printf("%c%d", i == 0 ? ' ' : ',', a->_cpus[i]);
+    }
+    if (a->_node >= 0)
+        printf(" node %d", a->_node);
+    printf("\n");
+}
+
+#endif // AFFINITY_H
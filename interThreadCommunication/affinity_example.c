@@ -0,0 +1,373 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "bench_common.h"
+#include "affinity.h"
+
+// Compile with:
+// gcc -O2 affinity_example.c -o affinity_example -pthread
+//
+// Usage:
+//   ./affinity_example [-c cpus] [-n node] [-s samples]
+//     -c  CPUs to measure, as a list such as 0-3,8 (default: every online CPU)
+//     -n  NUMA node for the shared cache line (default: first touch)
+//     -s  samples per pair (default 200)
+//
+// Two threads, each pinned to one CPU with pthread_setaffinity_np, pass a
+// turn counter back and forth through one cache line. Half a round trip is
+// the cost of one handoff between those two CPUs. Every pair of CPUs is
+// measured and printed as a matrix (p50 of the samples, in ns), then the
+// pairs are grouped by how close the CPUs are, read from /sys:
+//   - same-core:   both threads on one logical CPU, so they take turns
+//   - smt-sibling: two hardware threads of one core, sharing its L1/L2
+//   - same-llc:    two cores sharing a last-level cache
+//   - same-node:   different last-level caches on one NUMA node
+//   - cross-node:  CPUs on different NUMA nodes
+// The other benchmarks take the same placement through BENCH_CPUS and
+// BENCH_NODE (see affinity.h).
+
+#define DEFAULT_SAMPLES 200
+#define ROUNDS_PER_SAMPLE 100
+#define WARMUP_ROUNDS 1000
+#define SYS_CPU_DIR "/sys/devices/system/cpu"
+
+typedef enum
+{
+    CLASS_SAME_CORE,
+    CLASS_SMT_SIBLING,
+    CLASS_SAME_LLC,
+    CLASS_SAME_NODE,
+    CLASS_CROSS_NODE,
+    CLASS_COUNT
+} pair_class_t;
+
+static const char* class_names[CLASS_COUNT] = { "same-core", "smt-sibling", "same-llc", "same-node", "cross-node" };
+
+typedef struct
+{
+    int _cpu;
+    int _core; // Lowest CPU among its SMT siblings
+    int _llc;  // Lowest CPU sharing its last-level cache
+    int _node; // NUMA node, -1 if unknown
+} cpu_topology_t;
+
+// The line the two threads hand back and forth.
+typedef struct
+{
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t _turn;
+    _Atomic int _ready;
+} handoff_line_t;
+
+typedef struct
+{
+    handoff_line_t* _line;
+    int _cpu;
+    int _samples;
+    uint64_t* _sample_ns; // Ping side: one-way handoff time of each sample
+} handoff_arg_t;
+
+/**
+ * @brief Reads the first CPU of a CPU list file under /sys. Returns -1 if missing.
+ */
+static int read_first_cpu(const char* path)
+{
+    char buf[4096];
+    int cpus[1];
+    FILE* f = fopen(path, "r");
+    if (f == NULL)
+        return -1;
+    int ok = fgets(buf, sizeof(buf), f) != NULL && cpu_list_parse(buf, cpus, 1) == 1;
+    fclose(f);
+    return ok ? cpus[0] : -1;
+}
+
+static void read_topology(cpu_topology_t* t, int cpu)
+{
+    char path[256];
+    t->_cpu = cpu;
+
+    snprintf(path, sizeof(path), SYS_CPU_DIR "/cpu%d/topology/thread_siblings_list", cpu);
+    t->_core = read_first_cpu(path);
+    if (t->_core < 0)
+        t->_core = cpu;
+
+    // The last-level cache is the index with the highest level.
+    t->_llc = -1;
+    int best_level = 0;
+    for (int index = 0; index < 16; ++index)
+    {
+        int level = 0;
+        snprintf(path, sizeof(path), SYS_CPU_DIR "/cpu%d/cache/index%d/level", cpu, index);
+        FILE* f = fopen(path, "r");
+        if (f == NULL)
+            break;
+        if (fscanf(f, "%d", &level) != 1)
+            level = 0;
+        fclose(f);
+        if (level > best_level)
+        {
+            snprintf(path, sizeof(path), SYS_CPU_DIR "/cpu%d/cache/index%d/shared_cpu_list", cpu, index);
+            best_level = level;
+            t->_llc = read_first_cpu(path);
+        }
+    }
+    if (t->_llc < 0)
+        t->_llc = t->_core;
+
+    // The CPU's directory holds a nodeN link to its node.
+    t->_node = -1;
+    snprintf(path, sizeof(path), SYS_CPU_DIR "/cpu%d", cpu);
+    DIR* dir = opendir(path);
+    if (dir != NULL)
+    {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL)
+            if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9')
+                t->_node = atoi(entry->d_name + 4);
+        closedir(dir);
+    }
+}
+
+static pair_class_t classify(const cpu_topology_t* a, const cpu_topology_t* b)
+{
+    if (a->_cpu == b->_cpu)
+        return CLASS_SAME_CORE;
+    if (a->_core == b->_core)
+        return CLASS_SMT_SIBLING;
+    if (a->_llc == b->_llc)
+        return CLASS_SAME_LLC;
+    if (a->_node == b->_node)
+        return CLASS_SAME_NODE;
+    return CLASS_CROSS_NODE;
+}
+
+static void wait_for_turn(handoff_line_t* line, uint64_t turn)
+{
+    unsigned spins = 0;
+    while (atomic_load_explicit(&line->_turn, memory_order_acquire) != turn)
+        spin_backoff(&spins);
+}
+
+static int pin_self(int cpu)
+{
+    int rc = pin_thread(pthread_self(), cpu);
+    if (rc != 0)
+        fprintf(stderr, "pin to CPU %d: %s\n", cpu, strerror(rc));
+    return rc;
+}
+
+/**
+ * @brief Starts every round (odd turns) and times ROUNDS_PER_SAMPLE of them per sample.
+ */
+void* ping(void* arg)
+{
+    handoff_arg_t* h = arg;
+    handoff_line_t* line = h->_line;
+    pin_self(h->_cpu);
+    unsigned spins = 0;
+    while (!atomic_load_explicit(&line->_ready, memory_order_acquire))
+        spin_backoff(&spins);
+
+    uint64_t turn = 0;
+    for (int i = 0; i < WARMUP_ROUNDS; ++i)
+    {
+        atomic_store_explicit(&line->_turn, ++turn, memory_order_release);
+        wait_for_turn(line, ++turn);
+    }
+    for (int s = 0; s < h->_samples; ++s)
+    {
+        uint64_t start = now_ns();
+        for (int i = 0; i < ROUNDS_PER_SAMPLE; ++i)
+        {
+            atomic_store_explicit(&line->_turn, ++turn, memory_order_release);
+            wait_for_turn(line, ++turn);
+        }
+        h->_sample_ns[s] = (now_ns() - start) / (2 * ROUNDS_PER_SAMPLE);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Answers every odd turn with the next even one.
+ */
+void* pong(void* arg)
+{
+    handoff_arg_t* h = arg;
+    handoff_line_t* line = h->_line;
+    pin_self(h->_cpu);
+    atomic_store_explicit(&line->_ready, 1, memory_order_release);
+
+    long rounds = WARMUP_ROUNDS + (long)h->_samples * ROUNDS_PER_SAMPLE;
+    uint64_t turn = 0;
+    for (long i = 0; i < rounds; ++i)
+    {
+        wait_for_turn(line, ++turn);
+        atomic_store_explicit(&line->_turn, ++turn, memory_order_release);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Measures one CPU pair. Returns the median one-way handoff in ns.
+ */
+static uint64_t measure_pair(handoff_line_t* line, int cpu_a, int cpu_b, int samples, uint64_t* sample_ns)
+{
+    atomic_store_explicit(&line->_turn, 0, memory_order_relaxed);
+    atomic_store_explicit(&line->_ready, 0, memory_order_relaxed);
+
+    handoff_arg_t a = { line, cpu_a, samples, sample_ns };
+    handoff_arg_t b = { line, cpu_b, samples, NULL };
+    pthread_t ping_thread, pong_thread;
+    pthread_create(&ping_thread, NULL, ping, &a);
+    pthread_create(&pong_thread, NULL, pong, &b);
+    pthread_join(ping_thread, NULL);
+    pthread_join(pong_thread, NULL);
+
+    qsort(sample_ns, samples, sizeof(uint64_t), compare_u64);
+    return percentile_u64(sample_ns, samples, 50);
+}
+
+/**
+ * @brief Fills cpus with every online CPU. Returns the count, or -1.
+ */
+static int online_cpus(int* cpus, int max)
+{
+    char buf[4096];
+    FILE* f = fopen(SYS_CPU_DIR "/online", "r");
+    if (f == NULL)
+        return -1;
+    int count = fgets(buf, sizeof(buf), f) != NULL ? cpu_list_parse(buf, cpus, max) : -1;
+    fclose(f);
+    return count;
+}
+
+int main(int argc, char* argv[])
+{
+    static int cpus[AFFINITY_MAX_CPUS];
+    int cpu_count = 0;
+    int node = -1;
+    int samples = DEFAULT_SAMPLES;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:n:s:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c': cpu_count = cpu_list_parse(optarg, cpus, AFFINITY_MAX_CPUS); break;
+        case 'n': node = atoi(optarg); break;
+        case 's': samples = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-c cpus] [-n node] [-s samples]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (cpu_count == 0)
+        cpu_count = online_cpus(cpus, AFFINITY_MAX_CPUS);
+    // Keep only the CPUs this process may run on (cgroup or taskset limits).
+    cpu_set_t allowed;
+    if (cpu_count > 0 && sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    {
+        int kept = 0;
+        for (int i = 0; i < cpu_count; ++i)
+        {
+            if (cpus[i] < CPU_SETSIZE && CPU_ISSET(cpus[i], &allowed))
+                cpus[kept++] = cpus[i];
+            else
+                fprintf(stderr, "Skipping CPU %d: not in this process's affinity mask.\n", cpus[i]);
+        }
+        cpu_count = kept;
+    }
+    if (cpu_count <= 0 || samples < 1)
+    {
+        fprintf(stderr, "Need a valid CPU list and at least one sample.\n");
+        return 1;
+    }
+
+    cpu_topology_t* topo = malloc(cpu_count * sizeof(cpu_topology_t));
+    uint64_t* matrix = malloc((size_t)cpu_count * cpu_count * sizeof(uint64_t));
+    uint64_t* sample_ns = malloc(samples * sizeof(uint64_t));
+    if (topo == NULL || matrix == NULL || sample_ns == NULL)
+    {
+        perror("malloc");
+        return 1;
+    }
+    for (int i = 0; i < cpu_count; ++i)
+        read_topology(&topo[i], cpus[i]);
+
+    // A page of its own, bound before its first touch so it is allocated on the node.
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    handoff_line_t* line = mmap(NULL, page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (line == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+    if (node >= 0 && numa_bind_memory(line, page, node) != 0)
+    {
+        perror("mbind");
+        return 1;
+    }
+
+    printf("cpu  core  llc  node\n");
+    for (int i = 0; i < cpu_count; ++i)
+        printf("%3d %5d %4d %5d\n", topo[i]._cpu, topo[i]._core, topo[i]._llc, topo[i]._node);
+    printf("\nOne-way handoff, p50 ns (%d samples of %d round trips, ", samples, ROUNDS_PER_SAMPLE);
+    if (node >= 0)
+        printf("line on node %d)\n", node);
+    else
+        printf("line on the first-touch node)\n");
+
+    printf("%6s", "");
+    for (int j = 0; j < cpu_count; ++j)
+        printf(" %6d", cpus[j]);
+    printf("\n");
+    for (int i = 0; i < cpu_count; ++i)
+    {
+        printf("%6d", cpus[i]);
+        for (int j = 0; j < cpu_count; ++j)
+        {
+            // Handoffs are symmetric; measure each pair once.
+            if (j >= i)
+                matrix[i * cpu_count + j] = measure_pair(line, cpus[i], cpus[j], samples, sample_ns);
+            else
+                matrix[i * cpu_count + j] = matrix[j * cpu_count + i];
+            printf(" %6llu", (unsigned long long)matrix[i * cpu_count + j]);
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+
+    printf("\n%-12s %6s %10s %10s %10s\n", "class", "pairs", "min ns", "p50 ns", "max ns");
+    uint64_t* values = malloc((size_t)cpu_count * cpu_count * sizeof(uint64_t));
+    for (int c = 0; c < CLASS_COUNT && values != NULL; ++c)
+    {
+        size_t n = 0;
+        for (int i = 0; i < cpu_count; ++i)
+            for (int j = i; j < cpu_count; ++j)
+                if (classify(&topo[i], &topo[j]) == (pair_class_t)c)
+                    values[n++] = matrix[i * cpu_count + j];
+        if (n == 0)
+        {
+            printf("%-12s %6d %10s %10s %10s\n", class_names[c], 0, "-", "-", "-");
+            continue;
+        }
+        qsort(values, n, sizeof(uint64_t), compare_u64);
+        printf("%-12s %6zu %10llu %10llu %10llu\n", class_names[c], n, (unsigned long long)values[0],
+               (unsigned long long)percentile_u64(values, n, 50), (unsigned long long)values[n - 1]);
+    }
+
+    free(values);
+    munmap(line, page);
+    free(sample_ns);
+    free(matrix);
+    free(topo);
+    return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Helpers shared by the benchmark modes of the thread examples.
+
+// Size of a cache line on every x86-64 and most ARM64 parts.
+// Used to keep independently written variables from sharing a line.
+#define CACHE_LINE_SIZE 64
+
+/**
+ * @brief Returns a monotonic timestamp in nanoseconds.
+ */
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline int compare_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Returns the p-th percentile (0..100) of an array sorted in ascending order.
+ */
+static inline uint64_t percentile_u64(const uint64_t* sorted, size_t n, double p)
+{
+    if (n == 0)
+        return 0;
+    size_t index = (size_t)(p / 100.0 * (double)(n - 1) + 0.5);
+    return sorted[index];
+}
+
+/**
+ * @brief Backs off while the other side catches up.
+ * Spins with a pause hint first; yields the CPU once spinning is clearly not paying
+ * off, which also keeps the example usable on a single-core machine.
+ */
+static inline void spin_backoff(unsigned* spins)
+{
+    if (++(*spins) < 64)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+    else
+    {
+        sched_yield();
+    }
+}
+
+// Futex wrappers for words shared by threads of one process. The PRIVATE ops
+// let the kernel key the wait queue by address alone; for words in shared
+// memory see interProcessCommunication/shared_memory/futex.h.
+
+/**
+ * @brief Sleeps while *addr == expected, or until woken. Callers re-check
+ * their condition: the wait also ends on a signal or a spurious wake-up.
+ */
+static inline void futex_wait_private(_Atomic uint32_t* addr, uint32_t expected)
+{
+    syscall(SYS_futex, (uint32_t*)addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+/**
+ * @brief Wakes up to count threads sleeping on addr.
+ */
+static inline void futex_wake_private(_Atomic uint32_t* addr, int count)
+{
+    syscall(SYS_futex, (uint32_t*)addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+#endif // BENCH_COMMON_H
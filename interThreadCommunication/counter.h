@@ -0,0 +1,248 @@
+#ifndef COUNTER_H
+#define COUNTER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/rseq.h>
+
+#include "bench_common.h"
+
+// A statistics counter with selectable strategies, from the one-lock-per-increment
+// version in mutex_example.c to designs where writers never share a cache line.
+//
+//   COUNTER_MUTEX    - one long long under one pthread_mutex_t (mutex_example.c)
+//   COUNTER_ATOMIC   - one atomic long long, incremented with fetch_add
+//   COUNTER_SHARDED  - one padded slot per thread, summed on read
+//   COUNTER_PERCPU   - one padded slot per CPU, incremented inside a restartable
+//                      sequence (rseq) so no atomic instruction is needed
+//
+// Include after defining _GNU_SOURCE (for sched_getcpu).
+//
+// Reads of the sharded and per-CPU counters are a sum over all slots; they are
+// exact once the writers have stopped and monotonic (but possibly stale) while
+// they are running, which is what a statistics counter needs.
+
+typedef enum
+{
+    COUNTER_MUTEX = 0,
+    COUNTER_ATOMIC,
+    COUNTER_SHARDED,
+    COUNTER_PERCPU,
+    COUNTER_STRATEGY_COUNT
+} counter_strategy_t;
+
+static const char* counter_strategy_names[COUNTER_STRATEGY_COUNT] = { "mutex", "atomic", "sharded", "percpu-rseq" };
+
+// One slot per cache line so two writers never invalidate each other.
+typedef struct
+{
+    _Alignas(CACHE_LINE_SIZE) _Atomic long long _value;
+} counter_slot_t;
+
+typedef struct
+{
+    counter_strategy_t _strategy;
+
+    pthread_mutex_t _mutex;
+    long long _locked_value;
+
+    _Alignas(CACHE_LINE_SIZE) _Atomic long long _atomic_value;
+
+    counter_slot_t* _slots; // Per-thread (sharded) or per-CPU slots
+    int _slot_count;
+} counter_t;
+
+/**
+ * @brief Returns the strategy with the given name, or -1 if there is none.
+ */
+static inline int counter_strategy_from_name(const char* name)
+{
+    for (int i = 0; i < COUNTER_STRATEGY_COUNT; ++i)
+    {
+        if (strcmp(counter_strategy_names[i], name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+// --- Restartable sequences ---
+// glibc (2.35+) registers a struct rseq for every thread; the kernel keeps its
+// cpu_id up to date. A critical section is a short instruction block described
+// by a struct rseq_cs: if the thread is preempted, migrated or signalled while
+// inside it, the kernel restarts it at abort_ip instead of resuming. So
+// "check we are still on cpu X, then add to slot X" commits with a plain add and
+// can never interleave with another thread's add to the same slot.
+
+static inline struct rseq* counter_rseq_area(void)
+{
+    return (struct rseq*)((char*)__builtin_thread_pointer() + __rseq_offset);
+}
+
+static inline int counter_rseq_available(void)
+{
+    return __rseq_size > 0 && (int32_t)counter_rseq_area()->cpu_id >= 0;
+}
+
+#if defined(__x86_64__)
+/**
+ * @brief Adds count to *v if the thread is still running on cpu.
+ * Returns 0 on commit, -1 if the sequence was aborted (caller retries).
+ */
+static inline int counter_rseq_add(struct rseq* rs, long long* v, long long count, int cpu)
+{
+    __asm__ __volatile__ goto(
+        ".pushsection __rseq_cs, \"aw\"\n\t"
+        ".balign 32\n\t"
+        "3:\n\t"
+        ".long 0x0, 0x0\n\t"           // version, flags
+        ".quad 1f, (2f - 1f), 4f\n\t"  // start_ip, post_commit_offset, abort_ip
+        ".popsection\n\t"
+        "leaq 3b(%%rip), %%rax\n\t"
+        "movq %%rax, %[rseq_cs]\n\t"   // Arm the critical section
+        "1:\n\t"
+        "cmpl %[cpu], %[current_cpu]\n\t"
+        "jnz %l[abort]\n\t"
+        "addq %[count], %[v]\n\t"      // Commit
+        "2:\n\t"
+        ".pushsection __rseq_failure, \"ax\"\n\t"
+        // The abort handler must be preceded by the signature glibc registered.
+        ".byte 0x0f, 0xb9, 0x3d\n\t"
+        ".long 0x53053053\n\t"         // RSEQ_SIG
+        "4:\n\t"
+        "jmp %l[abort]\n\t"
+        ".popsection\n\t"
+        :
+        : [cpu] "r"(cpu), [current_cpu] "m"(rs->cpu_id), [rseq_cs] "m"(rs->rseq_cs),
+          [v] "m"(*v), [count] "er"(count)
+        : "memory", "cc", "rax"
+        : abort);
+    return 0;
+abort:
+    return -1;
+}
+#endif
+
+// --- API ---
+
+/**
+ * @brief Initializes a counter. max_threads bounds the thread indices passed
+ * to counter_add() for the sharded strategy. Returns 0 on success, -1 on error.
+ */
+static inline int counter_init(counter_t* c, counter_strategy_t strategy, int max_threads)
+{
+    c->_strategy = strategy;
+    c->_locked_value = 0;
+    atomic_store(&c->_atomic_value, 0);
+    c->_slots = NULL;
+    c->_slot_count = 0;
+    if (pthread_mutex_init(&c->_mutex, NULL) != 0)
+        return -1;
+
+    if (strategy == COUNTER_SHARDED || strategy == COUNTER_PERCPU)
+    {
+        c->_slot_count = (strategy == COUNTER_SHARDED) ? max_threads : (int)sysconf(_SC_NPROCESSORS_CONF);
+        if (c->_slot_count < 1)
+            c->_slot_count = 1;
+        c->_slots = aligned_alloc(CACHE_LINE_SIZE, c->_slot_count * sizeof(counter_slot_t));
+        if (c->_slots == NULL)
+            return -1;
+        for (int i = 0; i < c->_slot_count; ++i)
+            atomic_store_explicit(&c->_slots[i]._value, 0, memory_order_relaxed);
+    }
+    return 0;
+}
+
+static inline void counter_destroy(counter_t* c)
+{
+    pthread_mutex_destroy(&c->_mutex);
+    free(c->_slots);
+}
+
+/**
+ * @brief Adds delta to the counter on behalf of thread thread_index.
+ */
+static inline void counter_add(counter_t* c, int thread_index, long long delta)
+{
+    switch (c->_strategy)
+    {
+    case COUNTER_MUTEX:
+        pthread_mutex_lock(&c->_mutex);
+        c->_locked_value += delta;
+        pthread_mutex_unlock(&c->_mutex);
+        break;
+
+    case COUNTER_ATOMIC:
+        atomic_fetch_add_explicit(&c->_atomic_value, delta, memory_order_relaxed);
+        break;
+
+    case COUNTER_SHARDED:
+    {
+        // Only this thread writes its slot, so a relaxed load + store is enough;
+        // the atomic type just keeps concurrent reads well defined.
+        _Atomic long long* slot = &c->_slots[thread_index]._value;
+        atomic_store_explicit(slot, atomic_load_explicit(slot, memory_order_relaxed) + delta,
+                              memory_order_relaxed);
+        break;
+    }
+
+    case COUNTER_PERCPU:
+    {
+#if defined(__x86_64__)
+        if (counter_rseq_available())
+        {
+            struct rseq* rs = counter_rseq_area();
+            for (;;)
+            {
+                int cpu = (int)atomic_load_explicit((_Atomic uint32_t*)&rs->cpu_id_start, memory_order_relaxed);
+                if (counter_rseq_add(rs, (long long*)&c->_slots[cpu % c->_slot_count]._value, delta, cpu) == 0)
+                    break;
+            }
+            break;
+        }
+#endif
+        // No rseq: pick the slot for the current CPU and fall back to an atomic add,
+        // since we may be migrated between choosing the slot and updating it.
+        int cpu = sched_getcpu();
+        if (cpu < 0)
+            cpu = 0;
+        atomic_fetch_add_explicit(&c->_slots[cpu % c->_slot_count]._value, delta, memory_order_relaxed);
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Returns the current value of the counter.
+ */
+static inline long long counter_read(counter_t* c)
+{
+    long long value = 0;
+    switch (c->_strategy)
+    {
+    case COUNTER_MUTEX:
+        pthread_mutex_lock(&c->_mutex);
+        value = c->_locked_value;
+        pthread_mutex_unlock(&c->_mutex);
+        break;
+
+    case COUNTER_ATOMIC:
+        value = atomic_load_explicit(&c->_atomic_value, memory_order_relaxed);
+        break;
+
+    default:
+        for (int i = 0; i < c->_slot_count; ++i)
+            value += atomic_load_explicit(&c->_slots[i]._value, memory_order_relaxed);
+        break;
+    }
+    return value;
+}
+
+#endif // COUNTER_H
@@ -0,0 +1,122 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "affinity.h"
+#include "bench_common.h"
+#include "counter.h"
+
+// Compile with:
+// gcc -O2 counter_example.c -o counter_example -pthread
+//
+// Usage:
+//   ./counter_example [strategy|all] [max_threads] [increments_per_thread]
+//
+// mutex_example.c shows why the counter needs protection; this program shows what
+// the protection costs. Every strategy in counter.h is run with 1..max_threads
+// threads, each doing the same number of increments, and the final value is
+// checked against the expected total.
+
+#define DEFAULT_INCREMENTS 2000000
+
+static bench_affinity_t affinity; // BENCH_CPUS / BENCH_NODE
+
+typedef struct
+{
+    counter_t* _counter;
+    int _thread_index;
+    long _increments;
+} worker_arg_t;
+
+/**
+ * @brief The function executed by each thread.
+ * It increments the shared counter _increments times.
+ */
+void* worker_thread_function(void* arg)
+{
+    worker_arg_t* w = arg;
+    for (long i = 0; i < w->_increments; i++)
+        counter_add(w->_counter, w->_thread_index, 1);
+    return NULL;
+}
+
+/**
+ * @brief Runs one strategy with the given number of threads and prints a result row.
+ * Returns 0 if the final value is correct.
+ */
+static int run_strategy(counter_strategy_t strategy, int threads, long increments)
+{
+    counter_t counter;
+    pthread_t tids[threads];
+    worker_arg_t args[threads];
+
+    if (counter_init(&counter, strategy, threads) != 0)
+    {
+        perror("counter_init");
+        return -1;
+    }
+    if (counter._slots != NULL)
+        bench_affinity_place(&affinity, counter._slots, counter._slot_count * sizeof(counter_slot_t));
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < threads; ++i)
+    {
+        args[i] = (worker_arg_t){ &counter, i, increments };
+        pthread_create(&tids[i], NULL, worker_thread_function, &args[i]);
+        bench_affinity_pin(&affinity, tids[i], i);
+    }
+    for (int i = 0; i < threads; ++i)
+        pthread_join(tids[i], NULL);
+    uint64_t elapsed = now_ns() - start;
+
+    long long expected = (long long)threads * increments;
+    long long actual = counter_read(&counter);
+    counter_destroy(&counter);
+
+    printf("%-12s %8d %14.1f %10.2f %s\n", counter_strategy_names[strategy], threads,
+           expected / (elapsed / 1e9) / 1e6, (double)elapsed / expected,
+           actual == expected ? "ok" : "WRONG");
+    return actual == expected ? 0 : -1;
+}
+
+int main(int argc, char* argv[])
+{
+    int first = 0, last = COUNTER_STRATEGY_COUNT - 1;
+    int max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    long increments = DEFAULT_INCREMENTS;
+
+    if (argc >= 2 && strcmp(argv[1], "all") != 0)
+    {
+        first = last = counter_strategy_from_name(argv[1]);
+        if (first < 0)
+        {
+            fprintf(stderr, "usage: %s [mutex|atomic|sharded|percpu-rseq|all] [max_threads] [increments]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (argc >= 3)
+        max_threads = atoi(argv[2]);
+    if (argc >= 4)
+        increments = atol(argv[3]);
+    if (max_threads < 1)
+        max_threads = 1;
+
+    if (bench_affinity_from_env(&affinity) != 0)
+        return 1;
+    printf("rseq registered by libc: %s\n\n", counter_rseq_available() ? "yes" : "no (percpu falls back to atomics)");
+    bench_affinity_print(&affinity);
+    printf("%-12s %8s %14s %10s %s\n", "strategy", "threads", "Mincr/sec", "ns/incr", "result");
+
+    int failed = 0;
+    for (int s = first; s <= last; ++s)
+    {
+        for (int t = 1; t <= max_threads; ++t)
+            failed |= run_strategy(s, t, increments);
+    }
+
+    printf("\n%s\n", failed ? "Failure!" : "Success!");
+    return failed ? 1 : 0;
+}
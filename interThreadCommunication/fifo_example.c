@@ -7,6 +7,8 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include "../interProcessCommunication/fifo/frame.h"
+
 // Compile with:
 // gcc fifo_example.c -o fifo_example -pthread
 
@@ -14,6 +16,7 @@
 #define FIFO_PATH "/tmp/my_test_fifo"
 #define MAX_MESSAGES 10
 #define MSG_BUFFER_SIZE 100
+#define MESSAGES_PER_BATCH 5
 
 /**
  * @brief The producer thread. It creates a FIFO, opens it for writing,
@@ -22,7 +25,9 @@
 void* producer(void* arg)
 {
     int fifo_fd;
-    char message_buffer[MSG_BUFFER_SIZE];
+    char message_buffers[MESSAGES_PER_BATCH][MSG_BUFFER_SIZE];
+    struct iovec payloads[MESSAGES_PER_BATCH];
+    frame_stats_t stats = {0};
 
     printf("Producer: Waiting to connect to FIFO...\n");
 
@@ -36,14 +41,20 @@ void* producer(void* arg)
 
     printf("Producer: Consumer connected. Starting to send messages.\n");
 
-    for (int i = 0; i < MAX_MESSAGES; ++i)
+    for (int i = 0; i < MAX_MESSAGES; i += MESSAGES_PER_BATCH)
     {
-        snprintf(message_buffer, MSG_BUFFER_SIZE, "Message #%d from producer", i);
-        printf("Producer: Sending -> \"%s\"\n", message_buffer);
+        int count = 0;
+        for (; count < MESSAGES_PER_BATCH && i + count < MAX_MESSAGES; ++count)
+        {
+            int len = snprintf(message_buffers[count], MSG_BUFFER_SIZE, "Message #%d from producer", i + count);
+            printf("Producer: Sending -> \"%s\"\n", message_buffers[count]);
+            payloads[count].iov_base = message_buffers[count];
+            payloads[count].iov_len = len;
+        }
 
-        // Write the message to the FIFO.
+        // Write the batch to the FIFO as length-prefixed frames in one writev().
         // This can also block if the pipe's internal buffer is full.
-        if (write(fifo_fd, message_buffer, sizeof(message_buffer)) == -1) {
+        if (frame_writev(fifo_fd, payloads, count, &stats) == -1) {
             perror("Producer: Failed to write to FIFO");
             break;
         }
@@ -51,6 +62,7 @@ void* producer(void* arg)
     }
 
     printf("Producer: Finished sending messages. Closing FIFO.\n");
+    frame_stats_print(&stats, "Producer", MSG_BUFFER_SIZE);
 
     // Closing the write end of the FIFO will cause any readers
     // to receive an end-of-file (read() will return 0).
@@ -66,8 +78,10 @@ void* producer(void* arg)
 void* consumer(void* arg)
 {
     int fifo_fd;
-    char message_buffer[MSG_BUFFER_SIZE];
-    ssize_t bytes_read;
+    static frame_reader_t reader;
+    const char* payload;
+    size_t payload_len;
+    int status;
 
     printf("Consumer: Waiting to connect to FIFO...\n");
 
@@ -82,13 +96,15 @@ void* consumer(void* arg)
     printf("Consumer: Connected to FIFO. Waiting for messages.\n");
 
     // Loop until the producer closes its end of the pipe.
-    while ((bytes_read = read(fifo_fd, message_buffer, sizeof(message_buffer))) > 0)
+    // One read() may return several frames; frame_read() splits them.
+    frame_reader_init(&reader, fifo_fd);
+    while ((status = frame_read(&reader, &payload, &payload_len)) > 0)
     {
         // Successfully read a message.
-        printf("Consumer: Received <- \"%s\"\n", message_buffer);
+        printf("Consumer: Received <- \"%.*s\"\n", (int)payload_len, payload);
     }
 
-    if (bytes_read == 0) {
+    if (status == 0) {
         // End-of-file: The producer has closed its end. This is the expected exit.
         printf("Consumer: Producer closed the pipe. Exiting.\n");
     } else {
@@ -96,6 +112,7 @@ void* consumer(void* arg)
         perror("Consumer: Failed to read from FIFO");
     }
 
+    frame_stats_print(&reader._stats, "Consumer", MSG_BUFFER_SIZE);
     close(fifo_fd);
 
     // The main thread is responsible for deleting the FIFO file.
@@ -0,0 +1,102 @@
+#ifndef LOCKED_BUFFER_H
+#define LOCKED_BUFFER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+// The bounded buffer from condition_variable_example.c, packaged without the
+// printf calls so benchmarks can measure the mutex + condition variable design
+// itself. One mutex guards the indices and two condition variables signal
+// "not full" and "not empty", exactly like the example.
+
+typedef struct
+{
+    pthread_mutex_t _mutex;
+    pthread_cond_t _cond_not_full;
+    pthread_cond_t _cond_not_empty;
+    uint64_t* _items;
+    size_t _capacity;
+    size_t _count;     // Number of items currently in the buffer
+    size_t _in_index;  // Index where the producer will add the next item
+    size_t _out_index; // Index where the consumer will take the next item
+    int _broadcast;    // Wake every waiter instead of one (pthread_cond_broadcast)
+
+    // Wakeup accounting, updated under _mutex.
+    // A wasted wakeup is one that found the condition still false and went back to sleep.
+    unsigned long _wakeups;
+    unsigned long _wasted_wakeups;
+} locked_buffer_t;
+
+static inline int locked_buffer_init(locked_buffer_t* buf, size_t capacity)
+{
+    buf->_items = malloc(capacity * sizeof(uint64_t));
+    if (buf->_items == NULL)
+        return -1;
+    buf->_capacity = capacity;
+    buf->_count = 0;
+    buf->_in_index = 0;
+    buf->_out_index = 0;
+    buf->_broadcast = 0;
+    buf->_wakeups = 0;
+    buf->_wasted_wakeups = 0;
+    pthread_mutex_init(&buf->_mutex, NULL);
+    pthread_cond_init(&buf->_cond_not_full, NULL);
+    pthread_cond_init(&buf->_cond_not_empty, NULL);
+    return 0;
+}
+
+static inline void locked_buffer_destroy(locked_buffer_t* buf)
+{
+    pthread_mutex_destroy(&buf->_mutex);
+    pthread_cond_destroy(&buf->_cond_not_full);
+    pthread_cond_destroy(&buf->_cond_not_empty);
+    free(buf->_items);
+}
+
+static inline void locked_buffer_push(locked_buffer_t* buf, uint64_t item)
+{
+    pthread_mutex_lock(&buf->_mutex);
+    while (buf->_count == buf->_capacity)
+    {
+        pthread_cond_wait(&buf->_cond_not_full, &buf->_mutex);
+        buf->_wakeups++;
+        if (buf->_count == buf->_capacity)
+            buf->_wasted_wakeups++;
+    }
+
+    buf->_items[buf->_in_index] = item;
+    buf->_in_index = (buf->_in_index + 1) % buf->_capacity;
+    buf->_count++;
+
+    if (buf->_broadcast)
+        pthread_cond_broadcast(&buf->_cond_not_empty);
+    else
+        pthread_cond_signal(&buf->_cond_not_empty);
+    pthread_mutex_unlock(&buf->_mutex);
+}
+
+static inline uint64_t locked_buffer_pop(locked_buffer_t* buf)
+{
+    pthread_mutex_lock(&buf->_mutex);
+    while (buf->_count == 0)
+    {
+        pthread_cond_wait(&buf->_cond_not_empty, &buf->_mutex);
+        buf->_wakeups++;
+        if (buf->_count == 0)
+            buf->_wasted_wakeups++;
+    }
+
+    uint64_t item = buf->_items[buf->_out_index];
+    buf->_out_index = (buf->_out_index + 1) % buf->_capacity;
+    buf->_count--;
+
+    if (buf->_broadcast)
+        pthread_cond_broadcast(&buf->_cond_not_full);
+    else
+        pthread_cond_signal(&buf->_cond_not_full);
+    pthread_mutex_unlock(&buf->_mutex);
+    return item;
+}
+
+#endif // LOCKED_BUFFER_H
@@ -0,0 +1,144 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#include "bench_common.h"
+
+// Bounded multi-producer/multi-consumer queue (Dmitry Vyukov's design).
+//
+// Every cell carries a sequence number that says whose turn it is:
+//   sequence == pos      -> the cell is free for the producer claiming position pos
+//   sequence == pos + 1  -> the cell holds the item for the consumer claiming pos
+// Producers and consumers claim positions with a CAS on their own counter, so
+// the only shared writes are one CAS per operation plus the cell itself.
+// There is no global lock and a stalled thread only blocks its own cell.
+
+typedef struct
+{
+    _Atomic size_t _sequence;
+    uint64_t _data;
+} mpmc_cell_t;
+
+typedef struct
+{
+    mpmc_cell_t* _cells;
+    size_t _mask;
+    _Alignas(CACHE_LINE_SIZE) _Atomic size_t _enqueue_pos;
+    _Alignas(CACHE_LINE_SIZE) _Atomic size_t _dequeue_pos;
+    char _pad[CACHE_LINE_SIZE - sizeof(size_t)];
+} mpmc_queue_t;
+
+/**
+ * @brief Initializes the queue. Capacity must be a power of two (>= 2).
+ * Returns 0 on success, -1 on bad capacity or allocation failure.
+ */
+static inline int mpmc_queue_init(mpmc_queue_t* q, size_t capacity)
+{
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+        return -1;
+    q->_cells = aligned_alloc(CACHE_LINE_SIZE, capacity * sizeof(mpmc_cell_t));
+    if (q->_cells == NULL)
+        return -1;
+    for (size_t i = 0; i < capacity; ++i)
+        atomic_store_explicit(&q->_cells[i]._sequence, i, memory_order_relaxed);
+    q->_mask = capacity - 1;
+    atomic_store_explicit(&q->_enqueue_pos, 0, memory_order_relaxed);
+    atomic_store_explicit(&q->_dequeue_pos, 0, memory_order_relaxed);
+    return 0;
+}
+
+static inline void mpmc_queue_destroy(mpmc_queue_t* q)
+{
+    free(q->_cells);
+}
+
+/**
+ * @brief Tries to add an item. Returns 0 if the queue is full.
+ */
+static inline int mpmc_queue_try_push(mpmc_queue_t* q, uint64_t item)
+{
+    size_t pos = atomic_load_explicit(&q->_enqueue_pos, memory_order_relaxed);
+    mpmc_cell_t* cell;
+    for (;;)
+    {
+        cell = &q->_cells[pos & q->_mask];
+        size_t seq = atomic_load_explicit(&cell->_sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0)
+        {
+            // The cell is free for this position; try to claim it.
+            if (atomic_compare_exchange_weak_explicit(&q->_enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+            // CAS failure reloaded pos; retry with the new value.
+        }
+        else if (diff < 0)
+        {
+            // The consumer one lap behind has not emptied this cell yet: full.
+            return 0;
+        }
+        else
+        {
+            // Another producer claimed this position first.
+            pos = atomic_load_explicit(&q->_enqueue_pos, memory_order_relaxed);
+        }
+    }
+    cell->_data = item;
+    atomic_store_explicit(&cell->_sequence, pos + 1, memory_order_release);
+    return 1;
+}
+
+/**
+ * @brief Tries to remove an item. Returns 0 if the queue is empty.
+ */
+static inline int mpmc_queue_try_pop(mpmc_queue_t* q, uint64_t* item)
+{
+    size_t pos = atomic_load_explicit(&q->_dequeue_pos, memory_order_relaxed);
+    mpmc_cell_t* cell;
+    for (;;)
+    {
+        cell = &q->_cells[pos & q->_mask];
+        size_t seq = atomic_load_explicit(&cell->_sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&q->_dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // No producer has filled this position yet: empty.
+            return 0;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&q->_dequeue_pos, memory_order_relaxed);
+        }
+    }
+    *item = cell->_data;
+    // Hand the cell to the producer that will claim it one lap later.
+    atomic_store_explicit(&cell->_sequence, pos + q->_mask + 1, memory_order_release);
+    return 1;
+}
+
+static inline void mpmc_queue_push(mpmc_queue_t* q, uint64_t item)
+{
+    unsigned spins = 0;
+    while (!mpmc_queue_try_push(q, item))
+        spin_backoff(&spins);
+}
+
+static inline uint64_t mpmc_queue_pop(mpmc_queue_t* q)
+{
+    uint64_t item;
+    unsigned spins = 0;
+    while (!mpmc_queue_try_pop(q, &item))
+        spin_backoff(&spins);
+    return item;
+}
+
+#endif // MPMC_QUEUE_H
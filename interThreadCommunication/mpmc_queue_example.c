@@ -0,0 +1,250 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "affinity.h"
+#include "bench_common.h"
+#include "locked_buffer.h"
+#include "mpmc_queue.h"
+
+// Compile with:
+// gcc -O2 mpmc_queue_example.c -o mpmc_queue_example -pthread
+//
+// Usage:
+//   ./mpmc_queue_example [producers consumers [items]]  - one configuration
+//   ./mpmc_queue_example scale [items]                  - 1..N threads per side
+//
+// Runs the same N-producer/M-consumer workload through three queues:
+//   - the mutex + condvar buffer from condition_variable_example.c, waking one waiter (signal)
+//   - the same buffer waking every waiter (broadcast)
+//   - the lock-free MPMC queue from mpmc_queue.h
+// For the condvar designs it also reports how many wakeups were wasted, i.e. the
+// thread woke, re-took the mutex, found the condition still false and slept again.
+// That is the thundering-herd cost of broadcast.
+
+#define QUEUE_CAPACITY 1024
+#define DEFAULT_ITEMS 2000000
+
+static bench_affinity_t affinity; // BENCH_CPUS / BENCH_NODE
+
+typedef enum
+{
+    QUEUE_LOCKED_SIGNAL = 0,
+    QUEUE_LOCKED_BROADCAST,
+    QUEUE_MPMC
+} queue_kind_t;
+
+static const char* queue_names[] = { "condvar/signal", "condvar/broadcast", "mpmc" };
+
+typedef struct
+{
+    queue_kind_t _kind;
+    locked_buffer_t _locked;
+    mpmc_queue_t _mpmc;
+} bench_queue_t;
+
+// Per-thread work assignment. Padded so the result written by one thread
+// does not share a line with its neighbour's.
+typedef struct
+{
+    _Alignas(CACHE_LINE_SIZE) bench_queue_t* _queue;
+    long _items;
+    uint64_t _checksum;
+} worker_arg_t;
+
+static inline void queue_push(bench_queue_t* q, uint64_t item)
+{
+    if (q->_kind == QUEUE_MPMC)
+        mpmc_queue_push(&q->_mpmc, item);
+    else
+        locked_buffer_push(&q->_locked, item);
+}
+
+static inline uint64_t queue_pop(bench_queue_t* q)
+{
+    if (q->_kind == QUEUE_MPMC)
+        return mpmc_queue_pop(&q->_mpmc);
+    return locked_buffer_pop(&q->_locked);
+}
+
+/**
+ * @brief Pushes its share of the items. The checksum lets main() verify
+ * that every item came out of the queue exactly once.
+ */
+void* producer(void* arg)
+{
+    worker_arg_t* w = arg;
+    uint64_t sum = 0;
+    for (long i = 1; i <= w->_items; ++i)
+    {
+        queue_push(w->_queue, (uint64_t)i);
+        sum += i;
+    }
+    w->_checksum = sum;
+    return NULL;
+}
+
+void* consumer(void* arg)
+{
+    worker_arg_t* w = arg;
+    uint64_t sum = 0;
+    for (long i = 0; i < w->_items; ++i)
+        sum += queue_pop(w->_queue);
+    w->_checksum = sum;
+    return NULL;
+}
+
+/**
+ * @brief Runs one configuration and prints a result row.
+ * Returns 0 on success, -1 if the checksums do not match.
+ */
+static int run_config(queue_kind_t kind, int producers, int consumers, long items)
+{
+    bench_queue_t queue = { ._kind = kind };
+    if (kind == QUEUE_MPMC)
+    {
+        if (mpmc_queue_init(&queue._mpmc, QUEUE_CAPACITY) != 0) { perror("mpmc_queue_init"); return -1; }
+        bench_affinity_place(&affinity, queue._mpmc._cells, QUEUE_CAPACITY * sizeof(mpmc_cell_t));
+    }
+    else
+    {
+        if (locked_buffer_init(&queue._locked, QUEUE_CAPACITY) != 0) { perror("locked_buffer_init"); return -1; }
+        queue._locked._broadcast = (kind == QUEUE_LOCKED_BROADCAST);
+        bench_affinity_place(&affinity, queue._locked._items, QUEUE_CAPACITY * sizeof(uint64_t));
+    }
+
+    pthread_t* threads = malloc((producers + consumers) * sizeof(pthread_t));
+    worker_arg_t* args = aligned_alloc(CACHE_LINE_SIZE, (producers + consumers) * sizeof(worker_arg_t));
+    if (threads == NULL || args == NULL)
+    {
+        perror("malloc");
+        return -1;
+    }
+
+    // Split the items so every producer and consumer gets a fixed share
+    // and the totals match exactly; nobody needs a stop flag.
+    long per_producer = items / producers;
+    long total = per_producer * producers;
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < producers; ++i)
+    {
+        args[i] = (worker_arg_t){ ._queue = &queue, ._items = per_producer };
+        pthread_create(&threads[i], NULL, producer, &args[i]);
+        bench_affinity_pin(&affinity, threads[i], i);
+    }
+    for (int i = 0; i < consumers; ++i)
+    {
+        worker_arg_t* w = &args[producers + i];
+        *w = (worker_arg_t){ ._queue = &queue, ._items = total / consumers + (i < total % consumers) };
+        pthread_create(&threads[producers + i], NULL, consumer, w);
+        bench_affinity_pin(&affinity, threads[producers + i], producers + i);
+    }
+    for (int i = 0; i < producers + consumers; ++i)
+        pthread_join(threads[i], NULL);
+    uint64_t elapsed = now_ns() - start;
+
+    uint64_t produced = 0, consumed = 0;
+    for (int i = 0; i < producers; ++i)
+        produced += args[i]._checksum;
+    for (int i = 0; i < consumers; ++i)
+        consumed += args[producers + i]._checksum;
+
+    if (kind == QUEUE_MPMC)
+    {
+        printf("%-18s %4d %4d %14.0f %12s %12s\n", queue_names[kind], producers, consumers,
+               total / (elapsed / 1e9), "-", "-");
+        mpmc_queue_destroy(&queue._mpmc);
+    }
+    else
+    {
+        printf("%-18s %4d %4d %14.0f %12lu %12lu\n", queue_names[kind], producers, consumers,
+               total / (elapsed / 1e9), queue._locked._wakeups, queue._locked._wasted_wakeups);
+        locked_buffer_destroy(&queue._locked);
+    }
+
+    free(threads);
+    free(args);
+
+    if (produced != consumed)
+    {
+        fprintf(stderr, "Checksum mismatch: produced %llu, consumed %llu\n",
+                (unsigned long long)produced, (unsigned long long)consumed);
+        return -1;
+    }
+    return 0;
+}
+
+static void print_header(void)
+{
+    bench_affinity_print(&affinity);
+    printf("%-18s %4s %4s %14s %12s %12s\n", "queue", "P", "C", "items/sec", "wakeups", "wasted");
+}
+
+static int run_all(int producers, int consumers, long items)
+{
+    for (int kind = QUEUE_LOCKED_SIGNAL; kind <= QUEUE_MPMC; ++kind)
+    {
+        if (run_config(kind, producers, consumers, items) != 0)
+            return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    long items = DEFAULT_ITEMS;
+    if (bench_affinity_from_env(&affinity) != 0)
+        return 1;
+
+    if (argc >= 2 && strcmp(argv[1], "scale") == 0)
+    {
+        if (argc >= 3)
+            items = atol(argv[2]);
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        if (cores < 1)
+            cores = 1;
+
+        printf("Scaling from 1 to %ld producers and consumers, %ld items per run\n\n", cores, items);
+        print_header();
+        // Powers of two, then all cores if that is not a power of two itself.
+        for (long n = 1; ; n *= 2)
+        {
+            if (n > cores)
+                n = cores;
+            if (run_all(n, n, items) != 0)
+                return 1;
+            if (n == cores)
+                break;
+        }
+        return 0;
+    }
+
+    int producers = 2, consumers = 2;
+    if (argc >= 3)
+    {
+        producers = atoi(argv[1]);
+        consumers = atoi(argv[2]);
+        if (argc >= 4)
+            items = atol(argv[3]);
+    }
+    else if (argc == 2)
+    {
+        fprintf(stderr, "usage: %s [producers consumers [items]] | scale [items]\n", argv[0]);
+        return 1;
+    }
+
+    if (producers < 1 || consumers < 1 || items < producers)
+    {
+        fprintf(stderr, "Need at least one producer, one consumer and one item per producer.\n");
+        return 1;
+    }
+
+    printf("%d producers -> %d consumers, %ld items, capacity %d\n\n", producers, consumers, items, QUEUE_CAPACITY);
+    print_header();
+    return run_all(producers, consumers, items);
+}
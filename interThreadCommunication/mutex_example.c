@@ -4,6 +4,8 @@
 // To see the race condition, compile without -DUSE_MUTEX
 // To see the fix, compile with -DUSE_MUTEX
 // gcc mutex_example.c -o mutex_example -pthread -DUSE_MUTEX
+//
+// counter_example.c benchmarks this lock against contention-free counter strategies.
 
 // --- Shared Variable ---
 // This global variable is shared by all threads.
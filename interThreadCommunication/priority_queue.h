@@ -0,0 +1,127 @@
+#ifndef PRIORITY_QUEUE_H
+#define PRIORITY_QUEUE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "bench_common.h"
+#include "mpmc_queue.h"
+
+// Multi-level priority work queue.
+//
+// Each of the PRIORITY_LEVELS levels is its own lock-free MPMC queue
+// (mpmc_queue.h), so producers at different levels never touch the same
+// cells. A bitmap has bit p set while level p may hold items; a consumer finds
+// the highest non-empty level with one load and a count-leading-zeros, then
+// pops from it. An urgent item therefore waits only behind other urgent
+// items, never behind bulk items queued before it. Within a level, order is
+// FIFO. Higher numbers are more urgent.
+//
+// The bitmap is a hint kept conservative: a producer sets its bit after its
+// item is published, and a consumer only clears a bit after finding the level
+// empty, then checks the level once more. An item published before the clear
+// is found by that second look; one published after it sets the bit again. So
+// no item is ever left behind a clear bit.
+
+#define PRIORITY_LEVELS 8
+
+typedef struct
+{
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint32_t _nonempty; // Bit p: level p may be non-empty
+    mpmc_queue_t _levels[PRIORITY_LEVELS];
+} priority_queue_t;
+
+/**
+ * @brief Initializes every level with the given capacity (a power of two).
+ * Returns 0 on success, -1 on failure.
+ */
+static inline int priority_queue_init(priority_queue_t* q, size_t capacity_per_level)
+{
+    atomic_store_explicit(&q->_nonempty, 0, memory_order_relaxed);
+    for (int p = 0; p < PRIORITY_LEVELS; ++p)
+    {
+        if (mpmc_queue_init(&q->_levels[p], capacity_per_level) != 0)
+        {
+            while (--p >= 0)
+                mpmc_queue_destroy(&q->_levels[p]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static inline void priority_queue_destroy(priority_queue_t* q)
+{
+    for (int p = 0; p < PRIORITY_LEVELS; ++p)
+        mpmc_queue_destroy(&q->_levels[p]);
+}
+
+/**
+ * @brief Tries to add an item at the given level. Returns 0 if that level is full.
+ */
+static inline int priority_queue_try_push(priority_queue_t* q, int priority, uint64_t item)
+{
+    if (!mpmc_queue_try_push(&q->_levels[priority], item))
+        return 0;
+    // Under load the bit is almost always set already; reading it is cheaper
+    // than a locked RMW on a line every producer shares. The fence pairs with
+    // the one in try_pop: either the consumer's second look finds our item,
+    // or we see its clear and set the bit again.
+    uint32_t bit = 1u << priority;
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!(atomic_load_explicit(&q->_nonempty, memory_order_relaxed) & bit))
+        atomic_fetch_or_explicit(&q->_nonempty, bit, memory_order_release);
+    return 1;
+}
+
+/**
+ * @brief Tries to remove the oldest item of the highest non-empty level.
+ * Returns 0 if every level is empty; otherwise stores the item and, if
+ * priority is not NULL, its level.
+ */
+static inline int priority_queue_try_pop(priority_queue_t* q, uint64_t* item, int* priority)
+{
+    for (;;)
+    {
+        uint32_t nonempty = atomic_load_explicit(&q->_nonempty, memory_order_acquire);
+        if (nonempty == 0)
+            return 0;
+
+        int p = 31 - __builtin_clz(nonempty);
+        mpmc_queue_t* level = &q->_levels[p];
+        if (!mpmc_queue_try_pop(level, item))
+        {
+            // Looks empty: clear the bit, then look once more in case a
+            // producer published just before the clear.
+            atomic_fetch_and_explicit(&q->_nonempty, ~(1u << p), memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst);
+            if (!mpmc_queue_try_pop(level, item))
+                continue; // Really empty; try the next level down
+            atomic_fetch_or_explicit(&q->_nonempty, 1u << p, memory_order_release);
+        }
+        if (priority)
+            *priority = p;
+        return 1;
+    }
+}
+
+/**
+ * @brief Adds an item, backing off while its level is full.
+ */
+static inline void priority_queue_push(priority_queue_t* q, int priority, uint64_t item)
+{
+    unsigned spins = 0;
+    while (!priority_queue_try_push(q, priority, item))
+        spin_backoff(&spins);
+}
+
+static inline uint64_t priority_queue_pop(priority_queue_t* q, int* priority)
+{
+    uint64_t item;
+    unsigned spins = 0;
+    while (!priority_queue_try_pop(q, &item, priority))
+        spin_backoff(&spins);
+    return item;
+}
+
+#endif // PRIORITY_QUEUE_H
@@ -0,0 +1,230 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "affinity.h"
+#include "bench_common.h"
+#include "mpmc_queue.h"
+#include "priority_queue.h"
+
+// Compile with:
+// gcc -O2 priority_queue_example.c -o priority_queue_example -pthread
+//
+// Usage:
+//   ./priority_queue_example [producers consumers [items [work_ns]]]
+//
+// condition_variable_priority_example.c gives its threads SCHED_RR priorities,
+// but the items themselves go through one FIFO buffer, so an urgent item still
+// waits behind every bulk item queued before it. This runs the same mixed load
+// through two queues and reports the queueing latency (push to pop) of every
+// priority level:
+//   - fifo:     one MPMC queue (mpmc_queue.h) for every item, whatever its level
+//   - priority: the multi-level queue of priority_queue.h, highest level first
+// Levels follow a geometric mix: half the items are level 0, a quarter level 1,
+// and so on, so the most urgent level is under 1% of the load. Producers push
+// as fast as they can and consumers spend work_ns on each item, so a backlog
+// builds up and the order items leave it in is what the latencies show.
+
+#define DEFAULT_ITEMS 200000
+#define DEFAULT_WORK_NS 1000
+
+static bench_affinity_t affinity; // BENCH_CPUS / BENCH_NODE
+
+typedef struct
+{
+    uint64_t _enqueued_ns;
+    uint64_t _latency_ns;
+    int _priority;
+} work_item_t;
+
+typedef struct
+{
+    int _use_priority;
+    mpmc_queue_t _fifo;
+    priority_queue_t _levels;
+    work_item_t* _items;
+} bench_queue_t;
+
+// Padded so one thread's counters do not share a line with its neighbour's.
+typedef struct
+{
+    _Alignas(CACHE_LINE_SIZE) bench_queue_t* _queue;
+    long _first; // Producers push items [_first, _first + _count)
+    long _count; // Consumers pop _count items
+    uint64_t _work_ns;
+} worker_arg_t;
+
+/**
+ * @brief Geometric level mix from a per-producer xorshift generator.
+ */
+static int next_priority(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    // Trailing zeros: 0 for half the values, 1 for a quarter, ... capped at the top level
+    return __builtin_ctzll(x | (1ull << (PRIORITY_LEVELS - 1)));
+}
+
+void* producer(void* arg)
+{
+    worker_arg_t* w = arg;
+    bench_queue_t* q = w->_queue;
+    uint64_t state = 0x9E3779B97F4A7C15ull * (w->_first + 1);
+
+    for (long i = w->_first; i < w->_first + w->_count; ++i)
+    {
+        work_item_t* item = &q->_items[i];
+        item->_priority = next_priority(&state);
+        item->_enqueued_ns = now_ns();
+        if (q->_use_priority)
+            priority_queue_push(&q->_levels, item->_priority, (uint64_t)i);
+        else
+            mpmc_queue_push(&q->_fifo, (uint64_t)i);
+    }
+    return NULL;
+}
+
+void* consumer(void* arg)
+{
+    worker_arg_t* w = arg;
+    bench_queue_t* q = w->_queue;
+
+    for (long n = 0; n < w->_count; ++n)
+    {
+        uint64_t index = q->_use_priority ? priority_queue_pop(&q->_levels, NULL) : mpmc_queue_pop(&q->_fifo);
+        uint64_t now = now_ns();
+        q->_items[index]._latency_ns = now - q->_items[index]._enqueued_ns;
+
+        // Simulated processing of the item
+        while (now_ns() - now < w->_work_ns)
+            ;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Prints one row per priority level: item count and latency percentiles.
+ */
+static void report(const char* name, const work_item_t* items, long total)
+{
+    uint64_t* latencies = malloc(total * sizeof(uint64_t));
+    for (int level = PRIORITY_LEVELS - 1; level >= 0; --level)
+    {
+        size_t n = 0;
+        for (long i = 0; i < total; ++i)
+            if (items[i]._priority == level)
+                latencies[n++] = items[i]._latency_ns;
+        if (n == 0)
+            continue;
+        qsort(latencies, n, sizeof(uint64_t), compare_u64);
+        printf("%-9s %5d %8zu %12.1f %12.1f %12.1f\n", name, level, n,
+               percentile_u64(latencies, n, 50) / 1e3, percentile_u64(latencies, n, 99) / 1e3,
+               latencies[n - 1] / 1e3);
+    }
+    free(latencies);
+}
+
+static int run(int use_priority, int producers, int consumers, long items, uint64_t work_ns)
+{
+    bench_queue_t queue = { ._use_priority = use_priority };
+    queue._items = calloc(items, sizeof(work_item_t));
+
+    // Room for every item, so producers never block and the backlog is the
+    // whole run: the latencies show the pop order, not producer stalls.
+    size_t capacity = 2;
+    while (capacity < (size_t)items)
+        capacity *= 2;
+    int rc = use_priority ? priority_queue_init(&queue._levels, capacity) : mpmc_queue_init(&queue._fifo, capacity);
+    if (queue._items == NULL || rc != 0)
+    {
+        perror("queue init");
+        return -1;
+    }
+    bench_affinity_place(&affinity, queue._items, items * sizeof(work_item_t));
+    for (int p = 0; p < (use_priority ? PRIORITY_LEVELS : 1); ++p)
+    {
+        mpmc_queue_t* level = use_priority ? &queue._levels._levels[p] : &queue._fifo;
+        bench_affinity_place(&affinity, level->_cells, capacity * sizeof(mpmc_cell_t));
+    }
+
+    pthread_t* threads = malloc((producers + consumers) * sizeof(pthread_t));
+    worker_arg_t* args = aligned_alloc(CACHE_LINE_SIZE, (producers + consumers) * sizeof(worker_arg_t));
+    if (threads == NULL || args == NULL)
+    {
+        perror("malloc");
+        return -1;
+    }
+
+    long per_producer = items / producers;
+    for (int i = 0; i < producers; ++i)
+    {
+        args[i] = (worker_arg_t){ ._queue = &queue, ._first = i * per_producer,
+                                  ._count = i == producers - 1 ? items - i * per_producer : per_producer };
+        pthread_create(&threads[i], NULL, producer, &args[i]);
+        bench_affinity_pin(&affinity, threads[i], i);
+    }
+    for (int i = 0; i < consumers; ++i)
+    {
+        worker_arg_t* w = &args[producers + i];
+        *w = (worker_arg_t){ ._queue = &queue, ._count = items / consumers + (i < items % consumers), ._work_ns = work_ns };
+        pthread_create(&threads[producers + i], NULL, consumer, w);
+        bench_affinity_pin(&affinity, threads[producers + i], producers + i);
+    }
+    for (int i = 0; i < producers + consumers; ++i)
+        pthread_join(threads[i], NULL);
+
+    report(use_priority ? "priority" : "fifo", queue._items, items);
+
+    if (use_priority)
+        priority_queue_destroy(&queue._levels);
+    else
+        mpmc_queue_destroy(&queue._fifo);
+    free(queue._items);
+    free(threads);
+    free(args);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int producers = 2, consumers = 2;
+    long items = DEFAULT_ITEMS;
+    uint64_t work_ns = DEFAULT_WORK_NS;
+
+    if (argc == 2 || argc > 5)
+    {
+        fprintf(stderr, "usage: %s [producers consumers [items [work_ns]]]\n", argv[0]);
+        return 1;
+    }
+    if (argc >= 3)
+    {
+        producers = atoi(argv[1]);
+        consumers = atoi(argv[2]);
+    }
+    if (argc >= 4)
+        items = atol(argv[3]);
+    if (argc >= 5)
+        work_ns = strtoull(argv[4], NULL, 10);
+    if (producers < 1 || consumers < 1 || items < producers)
+    {
+        fprintf(stderr, "Need at least one producer, one consumer and one item per producer.\n");
+        return 1;
+    }
+
+    if (bench_affinity_from_env(&affinity) != 0)
+        return 1;
+    printf("%d producers -> %d consumers, %ld items, %llu ns of work per item\n\n",
+           producers, consumers, items, (unsigned long long)work_ns);
+    bench_affinity_print(&affinity);
+    printf("%-9s %5s %8s %12s %12s %12s\n", "queue", "level", "items", "p50_us", "p99_us", "max_us");
+    if (run(0, producers, consumers, items, work_ns) != 0 || run(1, producers, consumers, items, work_ns) != 0)
+        return 1;
+    return 0;
+}
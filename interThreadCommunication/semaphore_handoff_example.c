@@ -1,11 +1,22 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <pthread.h>
 #include <semaphore.h>
 #include <fcntl.h> // For O_CREAT constants
 #include <unistd.h> // For usleep
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+
+#include "bench_common.h"
 
 // Compile with:
 // gcc semaphore_handoff_example.c -o semaphore_handoff_example -pthread
+//
+// Run the demo:      ./semaphore_handoff_example
+// Run the benchmark: ./semaphore_handoff_example bench [round_trips]
 
 // --- Shared Variable ---
 long long shared_counter = 0;
@@ -83,10 +94,324 @@ void* worker_sevens(void* arg)
     return NULL;
 }
 
-int main()
+// --- Benchmark: which primitive hands off fastest? ---
+// The demo above passes the turn with named semaphores and sleeps between
+// steps so the output is readable. The benchmark keeps the handoff and drops
+// the sleeps: one thread posts the other, which posts back, and every round
+// trip is timed. The same ping-pong runs over each primitive that can carry
+// the turn between threads:
+//   - named-sem:   sem_open(), as in the demo
+//   - unnamed-sem: sem_init() on memory the threads share
+//   - futex:       a raw futex word, woken with a syscall on every post
+//   - eventfd:     read() and write() on an eventfd
+//   - condvar:     a flag under a mutex, signalled with a condition variable
+//   - spin-park:   spins on a flag for a while, then parks on a futex;
+//                  the poster only makes a syscall if the waiter has parked
+// Besides the latency percentiles it prints the voluntary context switches
+// per round trip: the ones that slept show about 2, and a waiter that caught
+// its turn while spinning shows 0.
+
+#define DEFAULT_ROUND_TRIPS 100000
+#define WARMUP_ROUND_TRIPS 1000
+#define SPIN_PARK_SPINS 100 // spin_backoff() calls before parking (about 64 pauses, then yields)
+
+// Spinning only pays if the poster can run meanwhile: on one CPU it cannot,
+// so spin-park parks at once there.
+static unsigned spin_park_spins = SPIN_PARK_SPINS;
+
+typedef enum
+{
+    HANDOFF_NAMED_SEM,
+    HANDOFF_UNNAMED_SEM,
+    HANDOFF_FUTEX,
+    HANDOFF_EVENTFD,
+    HANDOFF_CONDVAR,
+    HANDOFF_SPIN_PARK,
+    HANDOFF_COUNT
+} handoff_kind_t;
+
+static const char* handoff_names[HANDOFF_COUNT] = { "named-sem", "unnamed-sem", "futex", "eventfd", "condvar", "spin-park" };
+
+// Spin-park states
+#define PARK_EMPTY 0
+#define PARK_POSTED 1
+#define PARK_SLEEPING 2
+
+// One direction of the handoff: a post on it wakes the thread waiting on it.
+// Each channel has its own line so the two directions do not false-share.
+typedef struct
+{
+    _Alignas(CACHE_LINE_SIZE) sem_t* _named;
+    sem_t _unnamed;
+    _Atomic uint32_t _word; // futex and spin-park
+    int _eventfd;
+    pthread_mutex_t _mutex;
+    pthread_cond_t _cond;
+    int _flag;
+} channel_t;
+
+typedef struct
+{
+    handoff_kind_t _kind;
+    channel_t _to_pong;
+    channel_t _to_ping;
+    long _round_trips; // Timed; WARMUP_ROUND_TRIPS more are run first
+    uint64_t* _latencies;
+} handoff_bench_t;
+
+static int channel_init(handoff_kind_t kind, channel_t* ch, const char* name)
+{
+    memset(ch, 0, sizeof(*ch));
+    switch (kind)
+    {
+    case HANDOFF_NAMED_SEM:
+        sem_unlink(name);
+        ch->_named = sem_open(name, O_CREAT | O_EXCL, 0600, 0);
+        if (ch->_named == SEM_FAILED)
+            return -1;
+        sem_unlink(name); // Both threads already hold it; nothing else needs the name
+        return 0;
+    case HANDOFF_UNNAMED_SEM:
+        return sem_init(&ch->_unnamed, 0, 0);
+    case HANDOFF_FUTEX:
+    case HANDOFF_SPIN_PARK:
+        atomic_init(&ch->_word, 0);
+        return 0;
+    case HANDOFF_EVENTFD:
+        ch->_eventfd = eventfd(0, 0);
+        return ch->_eventfd == -1 ? -1 : 0;
+    case HANDOFF_CONDVAR:
+        pthread_mutex_init(&ch->_mutex, NULL);
+        pthread_cond_init(&ch->_cond, NULL);
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+static void channel_destroy(handoff_kind_t kind, channel_t* ch)
+{
+    if (kind == HANDOFF_NAMED_SEM)
+        sem_close(ch->_named);
+    else if (kind == HANDOFF_UNNAMED_SEM)
+        sem_destroy(&ch->_unnamed);
+    else if (kind == HANDOFF_EVENTFD)
+        close(ch->_eventfd);
+    else if (kind == HANDOFF_CONDVAR)
+    {
+        pthread_cond_destroy(&ch->_cond);
+        pthread_mutex_destroy(&ch->_mutex);
+    }
+}
+
+static void channel_post(handoff_kind_t kind, channel_t* ch)
+{
+    uint64_t one = 1;
+    switch (kind)
+    {
+    case HANDOFF_NAMED_SEM:
+        sem_post(ch->_named);
+        break;
+    case HANDOFF_UNNAMED_SEM:
+        sem_post(&ch->_unnamed);
+        break;
+    case HANDOFF_FUTEX:
+        atomic_store_explicit(&ch->_word, 1, memory_order_release);
+        futex_wake_private(&ch->_word, 1);
+        break;
+    case HANDOFF_EVENTFD:
+        if (write(ch->_eventfd, &one, sizeof(one)) != sizeof(one))
+            perror("eventfd write");
+        break;
+    case HANDOFF_CONDVAR:
+        pthread_mutex_lock(&ch->_mutex);
+        ch->_flag = 1;
+        pthread_cond_signal(&ch->_cond);
+        pthread_mutex_unlock(&ch->_mutex);
+        break;
+    case HANDOFF_SPIN_PARK:
+        // Only a parked waiter needs the syscall.
+        if (atomic_exchange_explicit(&ch->_word, PARK_POSTED, memory_order_release) == PARK_SLEEPING)
+            futex_wake_private(&ch->_word, 1);
+        break;
+    default:
+        break;
+    }
+}
+
+static void channel_wait(handoff_kind_t kind, channel_t* ch)
+{
+    uint64_t value;
+    unsigned spins = 0;
+    uint32_t expected;
+    switch (kind)
+    {
+    case HANDOFF_NAMED_SEM:
+        while (sem_wait(ch->_named) != 0)
+            ;
+        break;
+    case HANDOFF_UNNAMED_SEM:
+        while (sem_wait(&ch->_unnamed) != 0)
+            ;
+        break;
+    case HANDOFF_FUTEX:
+        while (atomic_exchange_explicit(&ch->_word, 0, memory_order_acquire) == 0)
+            futex_wait_private(&ch->_word, 0);
+        break;
+    case HANDOFF_EVENTFD:
+        if (read(ch->_eventfd, &value, sizeof(value)) != sizeof(value))
+            perror("eventfd read");
+        break;
+    case HANDOFF_CONDVAR:
+        pthread_mutex_lock(&ch->_mutex);
+        while (!ch->_flag)
+            pthread_cond_wait(&ch->_cond, &ch->_mutex);
+        ch->_flag = 0;
+        pthread_mutex_unlock(&ch->_mutex);
+        break;
+    case HANDOFF_SPIN_PARK:
+        while (spins < spin_park_spins)
+        {
+            expected = PARK_POSTED;
+            if (atomic_compare_exchange_weak_explicit(&ch->_word, &expected, PARK_EMPTY,
+                                                      memory_order_acquire, memory_order_relaxed))
+                return;
+            spin_backoff(&spins);
+        }
+        for (;;)
+        {
+            expected = PARK_POSTED;
+            if (atomic_compare_exchange_strong_explicit(&ch->_word, &expected, PARK_EMPTY,
+                                                        memory_order_acquire, memory_order_relaxed))
+                return;
+            // Announce that we sleep, unless the post landed in between.
+            if (expected == PARK_SLEEPING ||
+                atomic_compare_exchange_strong_explicit(&ch->_word, &expected, PARK_SLEEPING,
+                                                        memory_order_relaxed, memory_order_relaxed))
+                futex_wait_private(&ch->_word, PARK_SLEEPING);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void* bench_ping(void* arg)
+{
+    handoff_bench_t* b = arg;
+    for (long i = 0; i < WARMUP_ROUND_TRIPS; ++i)
+    {
+        channel_post(b->_kind, &b->_to_pong);
+        channel_wait(b->_kind, &b->_to_ping);
+    }
+    for (long i = 0; i < b->_round_trips; ++i)
+    {
+        uint64_t start = now_ns();
+        channel_post(b->_kind, &b->_to_pong);
+        channel_wait(b->_kind, &b->_to_ping);
+        b->_latencies[i] = now_ns() - start;
+    }
+    return NULL;
+}
+
+void* bench_pong(void* arg)
+{
+    handoff_bench_t* b = arg;
+    for (long i = 0; i < WARMUP_ROUND_TRIPS + b->_round_trips; ++i)
+    {
+        channel_wait(b->_kind, &b->_to_pong);
+        channel_post(b->_kind, &b->_to_ping);
+    }
+    return NULL;
+}
+
+static long voluntary_switches(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw;
+}
+
+static int run_handoff(handoff_kind_t kind, long round_trips, uint64_t* latencies)
+{
+    static handoff_bench_t bench; // Static: channel_t is cache-line aligned
+    bench._kind = kind;
+    bench._round_trips = round_trips;
+    bench._latencies = latencies;
+    if (channel_init(kind, &bench._to_pong, "/handoff_bench_pong") != 0)
+    {
+        perror(handoff_names[kind]);
+        return -1;
+    }
+    if (channel_init(kind, &bench._to_ping, "/handoff_bench_ping") != 0)
+    {
+        perror(handoff_names[kind]);
+        channel_destroy(kind, &bench._to_pong);
+        return -1;
+    }
+
+    pthread_t ping_thread, pong_thread;
+    long switches = voluntary_switches();
+    uint64_t start = now_ns();
+    pthread_create(&pong_thread, NULL, bench_pong, &bench);
+    pthread_create(&ping_thread, NULL, bench_ping, &bench);
+    pthread_join(ping_thread, NULL);
+    pthread_join(pong_thread, NULL);
+    uint64_t elapsed = now_ns() - start;
+    switches = voluntary_switches() - switches;
+
+    channel_destroy(kind, &bench._to_pong);
+    channel_destroy(kind, &bench._to_ping);
+
+    qsort(latencies, round_trips, sizeof(uint64_t), compare_u64);
+    printf("%-12s %12.0f %10llu %10llu %10llu %10llu %10.2f\n", handoff_names[kind],
+           (WARMUP_ROUND_TRIPS + round_trips) / (elapsed / 1e9),
+           (unsigned long long)percentile_u64(latencies, round_trips, 50),
+           (unsigned long long)percentile_u64(latencies, round_trips, 99),
+           (unsigned long long)percentile_u64(latencies, round_trips, 99.9),
+           (unsigned long long)latencies[round_trips - 1],
+           (double)switches / (WARMUP_ROUND_TRIPS + round_trips));
+    return 0;
+}
+
+static int run_benchmark(long round_trips)
+{
+    uint64_t* latencies = malloc(round_trips * sizeof(uint64_t));
+    if (latencies == NULL)
+    {
+        perror("malloc");
+        return 1;
+    }
+
+    if (sysconf(_SC_NPROCESSORS_ONLN) <= 1)
+        spin_park_spins = 0;
+    printf("Benchmark: %ld round trips per primitive, 2 threads, spin-park spins %u times\n\n", round_trips,
+           spin_park_spins);
+    printf("%-12s %12s %10s %10s %10s %10s %10s\n", "primitive", "trips/sec", "p50 ns", "p99 ns", "p99.9 ns",
+           "max ns", "ctxsw/trip");
+    int failed = 0;
+    for (int kind = 0; kind < HANDOFF_COUNT; ++kind)
+        failed |= run_handoff(kind, round_trips, latencies);
+
+    free(latencies);
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char* argv[])
 {
     pthread_t thread_non_sevens, thread_sevens;
 
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0)
+    {
+        long round_trips = (argc >= 3) ? atol(argv[2]) : DEFAULT_ROUND_TRIPS;
+        if (round_trips <= 0)
+        {
+            fprintf(stderr, "usage: %s [bench [round_trips]]\n", argv[0]);
+            return 1;
+        }
+        return run_benchmark(round_trips);
+    }
+
     // Unlink any previous instances of the semaphores, in case the program crashed.
     sem_unlink(NON_SEVENS_SEM_NAME);
     sem_unlink(SEVENS_SEM_NAME);
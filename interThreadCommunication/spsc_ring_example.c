@@ -0,0 +1,265 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "affinity.h"
+#include "bench_common.h"
+#include "locked_buffer.h"
+
+// Compile with:
+// gcc -O2 spsc_ring_example.c -o spsc_ring_example -pthread
+//
+// Run the demo:      ./spsc_ring_example
+// Run the benchmark: ./spsc_ring_example bench [items]
+//   BENCH_CPUS=0,1 BENCH_NODE=0 ./spsc_ring_example bench   pins producer/consumer, places the queues
+//
+// The same producer/consumer hand-off as condition_variable_example.c, but
+// without a mutex: with exactly one producer and one consumer, each index has a
+// single writer, so publishing it with a release store is enough.
+
+// --- Lock-free SPSC Ring ---
+// The capacity is a power of two so "index & RING_MASK" replaces "% BUFFER_SIZE".
+#define RING_CAPACITY 1024
+#define RING_MASK (RING_CAPACITY - 1)
+_Static_assert((RING_CAPACITY & RING_MASK) == 0, "RING_CAPACITY must be a power of two");
+
+typedef struct
+{
+    // Producer's line: written only by the producer, read by the consumer.
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t _head;
+    uint64_t _cached_tail; // Producer's last view of _tail, reloaded only when the ring looks full
+
+    // Consumer's line: written only by the consumer, read by the producer.
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t _tail;
+    uint64_t _cached_head; // Consumer's last view of _head, reloaded only when the ring looks empty
+
+    _Alignas(CACHE_LINE_SIZE) uint64_t _items[RING_CAPACITY];
+} spsc_ring_t;
+
+// The indices run freely and are only masked when touching _items,
+// so "head - tail" is always the number of items in the ring.
+
+/**
+ * @brief Tries to add an item. Returns 0 if the ring is full.
+ */
+static inline int spsc_ring_try_push(spsc_ring_t* ring, uint64_t item)
+{
+    uint64_t head = atomic_load_explicit(&ring->_head, memory_order_relaxed);
+    if (head - ring->_cached_tail == RING_CAPACITY)
+    {
+        ring->_cached_tail = atomic_load_explicit(&ring->_tail, memory_order_acquire);
+        if (head - ring->_cached_tail == RING_CAPACITY)
+            return 0;
+    }
+    ring->_items[head & RING_MASK] = item;
+    // Release: the item must be visible before the consumer sees the new head.
+    atomic_store_explicit(&ring->_head, head + 1, memory_order_release);
+    return 1;
+}
+
+/**
+ * @brief Tries to remove an item. Returns 0 if the ring is empty.
+ */
+static inline int spsc_ring_try_pop(spsc_ring_t* ring, uint64_t* item)
+{
+    uint64_t tail = atomic_load_explicit(&ring->_tail, memory_order_relaxed);
+    if (tail == ring->_cached_head)
+    {
+        ring->_cached_head = atomic_load_explicit(&ring->_head, memory_order_acquire);
+        if (tail == ring->_cached_head)
+            return 0;
+    }
+    *item = ring->_items[tail & RING_MASK];
+    // Release: we must be done reading the slot before the producer may reuse it.
+    atomic_store_explicit(&ring->_tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+static inline void spsc_ring_push(spsc_ring_t* ring, uint64_t item)
+{
+    unsigned spins = 0;
+    while (!spsc_ring_try_push(ring, item))
+        spin_backoff(&spins);
+}
+
+static inline uint64_t spsc_ring_pop(spsc_ring_t* ring)
+{
+    uint64_t item;
+    unsigned spins = 0;
+    while (!spsc_ring_try_pop(ring, &item))
+        spin_backoff(&spins);
+    return item;
+}
+
+// --- Demo ---
+#define MAX_ROUNDS 200
+
+spsc_ring_t ring;
+
+/**
+ * @brief Produces items and puts them into the ring.
+ */
+void* producer(void* arg)
+{
+    for (int i = 0; i < MAX_ROUNDS; ++i)
+    {
+        uint64_t item = i * 10; // Produce an item
+
+        if (!spsc_ring_try_push(&ring, item))
+        {
+            printf("Producer: Ring is FULL. Spinning...\n");
+            spsc_ring_push(&ring, item);
+        }
+        printf("Producer: Produced item %llu\n", (unsigned long long)item);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Consumes items from the ring.
+ */
+void* consumer(void* arg)
+{
+    for (int i = 0; i < MAX_ROUNDS; ++i)
+    {
+        uint64_t item;
+        if (!spsc_ring_try_pop(&ring, &item))
+        {
+            printf("Consumer: Ring is EMPTY. Spinning...\n");
+            item = spsc_ring_pop(&ring);
+        }
+        printf("Consumer: Consumed item %llu\n", (unsigned long long)item);
+    }
+    return NULL;
+}
+
+// --- Benchmark ---
+// The producer sends its send timestamp as the item, so the consumer can
+// compute the per-item latency (time spent queued plus hand-off cost).
+#define DEFAULT_BENCH_ITEMS 2000000
+
+static bench_affinity_t affinity; // BENCH_CPUS / BENCH_NODE
+
+typedef struct
+{
+    const char* _name;
+    void (*_push)(void* queue, uint64_t item);
+    uint64_t (*_pop)(void* queue);
+    void* _queue;
+    long _items;
+    uint64_t* _latencies;
+} bench_run_t;
+
+static void bench_ring_push(void* queue, uint64_t item) { spsc_ring_push(queue, item); }
+static uint64_t bench_ring_pop(void* queue) { return spsc_ring_pop(queue); }
+static void bench_locked_push(void* queue, uint64_t item) { locked_buffer_push(queue, item); }
+static uint64_t bench_locked_pop(void* queue) { return locked_buffer_pop(queue); }
+
+void* bench_producer(void* arg)
+{
+    bench_run_t* run = arg;
+    for (long i = 0; i < run->_items; ++i)
+        run->_push(run->_queue, now_ns());
+    return NULL;
+}
+
+void* bench_consumer(void* arg)
+{
+    bench_run_t* run = arg;
+    for (long i = 0; i < run->_items; ++i)
+    {
+        uint64_t sent = run->_pop(run->_queue);
+        run->_latencies[i] = now_ns() - sent;
+    }
+    return NULL;
+}
+
+static void bench_report(bench_run_t* run)
+{
+    pthread_t prod_thread, cons_thread;
+
+    uint64_t start = now_ns();
+    pthread_create(&prod_thread, NULL, bench_producer, run);
+    pthread_create(&cons_thread, NULL, bench_consumer, run);
+    bench_affinity_pin(&affinity, prod_thread, 0);
+    bench_affinity_pin(&affinity, cons_thread, 1);
+    pthread_join(prod_thread, NULL);
+    pthread_join(cons_thread, NULL);
+    uint64_t elapsed = now_ns() - start;
+
+    qsort(run->_latencies, run->_items, sizeof(uint64_t), compare_u64);
+    uint64_t sum = 0;
+    for (long i = 0; i < run->_items; ++i)
+        sum += run->_latencies[i];
+
+    printf("%-16s %14.0f %12.1f %10llu %10llu %12llu\n",
+           run->_name,
+           run->_items / (elapsed / 1e9),
+           (double)sum / run->_items,
+           (unsigned long long)percentile_u64(run->_latencies, run->_items, 50),
+           (unsigned long long)percentile_u64(run->_latencies, run->_items, 99),
+           (unsigned long long)percentile_u64(run->_latencies, run->_items, 99.9));
+}
+
+static int run_benchmark(long items)
+{
+    static spsc_ring_t bench_ring;
+    locked_buffer_t locked;
+
+    uint64_t* latencies = malloc(items * sizeof(uint64_t));
+    if (latencies == NULL || locked_buffer_init(&locked, RING_CAPACITY) != 0)
+    {
+        perror("malloc");
+        return 1;
+    }
+    if (bench_affinity_from_env(&affinity) != 0)
+        return 1;
+    bench_affinity_place(&affinity, &bench_ring, sizeof(bench_ring));
+    bench_affinity_place(&affinity, locked._items, RING_CAPACITY * sizeof(uint64_t));
+
+    printf("Benchmark: %ld items, capacity %d, 1 producer -> 1 consumer\n\n", items, RING_CAPACITY);
+    bench_affinity_print(&affinity);
+    printf("%-16s %14s %12s %10s %10s %12s\n", "queue", "items/sec", "avg ns", "p50 ns", "p99 ns", "p99.9 ns");
+
+    bench_run_t locked_run = { "mutex+condvar", bench_locked_push, bench_locked_pop, &locked, items, latencies };
+    bench_report(&locked_run);
+
+    bench_run_t ring_run = { "spsc ring", bench_ring_push, bench_ring_pop, &bench_ring, items, latencies };
+    bench_report(&ring_run);
+
+    locked_buffer_destroy(&locked);
+    free(latencies);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0)
+    {
+        long items = (argc >= 3) ? atol(argv[2]) : DEFAULT_BENCH_ITEMS;
+        if (items <= 0)
+        {
+            fprintf(stderr, "usage: %s [bench [items]]\n", argv[0]);
+            return 1;
+        }
+        return run_benchmark(items);
+    }
+
+    pthread_t prod_thread, cons_thread;
+
+    printf("Starting Producer and Consumer threads on a lock-free SPSC ring...\n");
+
+    pthread_create(&prod_thread, NULL, producer, NULL);
+    pthread_create(&cons_thread, NULL, consumer, NULL);
+
+    pthread_join(prod_thread, NULL);
+    pthread_join(cons_thread, NULL);
+
+    printf("\nThreads have finished.\n");
+
+    return 0;
+}
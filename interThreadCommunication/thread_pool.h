@@ -0,0 +1,417 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "bench_common.h"
+
+// Work-stealing thread pool for fork/join task trees.
+//
+// Every worker owns a Chase-Lev deque. It pushes the tasks it spawns at the
+// bottom and pops them back from the bottom, newest first, so a recursive
+// task tree runs depth-first on one worker with no shared writes at all. An
+// idle worker steals from the top of another worker's deque, which takes the
+// oldest and usually biggest piece of that worker's tree. Contention only
+// happens when a thief and the owner go for the last task together.
+//
+// Tasks submitted from outside the pool go to a global injection list that
+// workers check before stealing. It is only touched when work enters the pool,
+// so a mutex is enough.
+//
+// A worker that finds nothing anywhere parks on a futex. Spawning a task only
+// makes the wake syscall if some worker is actually parked.
+//
+// Tasks are intrusive and owned by the caller: embed a task_t in your own
+// struct and recover it in the callback. Spawned tasks belong to a
+// task_group_t; waiting on the group from a worker runs other tasks meanwhile,
+// so a parent can keep its children on its own stack.
+
+#define WS_DEQUE_CAPACITY 8192 // Per worker; a full deque spills into the injection list
+#define TP_IDLE_SPINS 64       // Failed searches before a worker parks
+
+typedef struct task task_t;
+typedef void (*task_fn_t)(task_t* task);
+
+typedef struct
+{
+    _Atomic uint32_t _pending; // Spawned tasks not yet finished; futex word for outside waiters
+    _Atomic uint32_t _waiting; // Set while a thread outside the pool sleeps on _pending
+} task_group_t;
+
+struct task
+{
+    task_fn_t _fn;
+    task_group_t* _group;
+    task_t* _next; // Link in the injection list
+};
+
+typedef struct
+{
+    _Alignas(CACHE_LINE_SIZE) _Atomic int64_t _top;  // Thieves take from here
+    _Alignas(CACHE_LINE_SIZE) _Atomic int64_t _bottom; // Owner pushes and pops here
+    _Atomic(task_t*) _slots[WS_DEQUE_CAPACITY];
+} ws_deque_t;
+
+typedef struct thread_pool thread_pool_t;
+
+typedef struct
+{
+    ws_deque_t _deque;
+    thread_pool_t* _pool;
+    pthread_t _thread;
+    int _index;
+    uint64_t _rng; // Picks the first victim to steal from
+
+    // Written only by this worker; read after the pool stops.
+    unsigned long _executed;
+    unsigned long _stolen;
+    unsigned long _parks;
+} tp_worker_t;
+
+struct thread_pool
+{
+    tp_worker_t* _workers;
+    int _count;
+
+    pthread_mutex_t _inject_mutex;
+    task_t* _inject_head;
+    task_t* _inject_tail;
+    _Alignas(CACHE_LINE_SIZE) _Atomic size_t _injected; // Lets workers skip the mutex when empty
+
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint32_t _epoch; // Futex word parked workers sleep on
+    _Atomic int _sleepers;
+    _Atomic int _stop;
+};
+
+static _Thread_local tp_worker_t* tp_self; // The worker running on this thread, if any
+
+// --- Chase-Lev deque (the C11 formulation of Lê et al., PPoPP 2013) ---
+
+/**
+ * @brief Owner only. Returns 0 if the deque is full.
+ */
+static inline int ws_deque_push(ws_deque_t* d, task_t* task)
+{
+    int64_t b = atomic_load_explicit(&d->_bottom, memory_order_relaxed);
+    int64_t t = atomic_load_explicit(&d->_top, memory_order_acquire);
+    if (b - t >= WS_DEQUE_CAPACITY)
+        return 0;
+    atomic_store_explicit(&d->_slots[b & (WS_DEQUE_CAPACITY - 1)], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->_bottom, b + 1, memory_order_relaxed);
+    return 1;
+}
+
+/**
+ * @brief Owner only. Takes the newest task, or returns NULL.
+ */
+static inline task_t* ws_deque_pop(ws_deque_t* d)
+{
+    int64_t b = atomic_load_explicit(&d->_bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->_bottom, b, memory_order_relaxed);
+    // Claim slot b before looking at _top, so a thief cannot take it unseen.
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t t = atomic_load_explicit(&d->_top, memory_order_relaxed);
+
+    if (t > b)
+    {
+        atomic_store_explicit(&d->_bottom, b + 1, memory_order_relaxed);
+        return NULL; // Empty
+    }
+    task_t* task = atomic_load_explicit(&d->_slots[b & (WS_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    if (t == b)
+    {
+        // The last task: race the thieves for it on _top.
+        if (!atomic_compare_exchange_strong_explicit(&d->_top, &t, t + 1, memory_order_seq_cst,
+                                                     memory_order_relaxed))
+            task = NULL;
+        atomic_store_explicit(&d->_bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+/**
+ * @brief Any thread. Takes the oldest task, or returns NULL if the deque is
+ * empty or another thread won the race for it.
+ */
+static inline task_t* ws_deque_steal(ws_deque_t* d)
+{
+    int64_t t = atomic_load_explicit(&d->_top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t b = atomic_load_explicit(&d->_bottom, memory_order_acquire);
+    if (t >= b)
+        return NULL;
+    task_t* task = atomic_load_explicit(&d->_slots[t & (WS_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->_top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+        return NULL;
+    return task;
+}
+
+// --- Task groups ---
+
+static inline void task_group_init(task_group_t* group)
+{
+    atomic_init(&group->_pending, 0);
+    atomic_init(&group->_waiting, 0);
+}
+
+/**
+ * @brief Runs a task and marks it finished in its group.
+ */
+static inline void task_run(task_t* task)
+{
+    task_group_t* group = task->_group; // The callback may reuse the task
+    task->_fn(task);
+    // Once _pending reaches 0 a helping waiter may return and its group go out
+    // of scope before _waiting is read; a stale read only costs a spurious
+    // wake, and futex waiters re-check their word.
+    if (atomic_fetch_sub_explicit(&group->_pending, 1, memory_order_seq_cst) == 1 &&
+        atomic_load_explicit(&group->_waiting, memory_order_seq_cst))
+        futex_wake_private(&group->_pending, INT_MAX);
+}
+
+/**
+ * @brief Sleeps until every task of the group has finished, without running
+ * any of them. For threads outside the pool.
+ */
+static inline void task_group_sleep(task_group_t* group)
+{
+    atomic_store_explicit(&group->_waiting, 1, memory_order_seq_cst);
+    uint32_t pending;
+    while ((pending = atomic_load_explicit(&group->_pending, memory_order_seq_cst)) != 0)
+        futex_wait_private(&group->_pending, pending);
+}
+
+// --- Pool ---
+
+/**
+ * @brief Wakes one parked worker, if there is one. Call after publishing work.
+ */
+static inline void thread_pool_notify(thread_pool_t* pool)
+{
+    // Pairs with the fence in thread_pool_park: either the worker sees the
+    // new task, or we see it counted as a sleeper.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&pool->_sleepers, memory_order_relaxed) > 0)
+    {
+        atomic_fetch_add_explicit(&pool->_epoch, 1, memory_order_release);
+        futex_wake_private(&pool->_epoch, 1);
+    }
+}
+
+static inline void thread_pool_inject(thread_pool_t* pool, task_t* task)
+{
+    task->_next = NULL;
+    pthread_mutex_lock(&pool->_inject_mutex);
+    if (pool->_inject_tail)
+        pool->_inject_tail->_next = task;
+    else
+        pool->_inject_head = task;
+    pool->_inject_tail = task;
+    atomic_fetch_add_explicit(&pool->_injected, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&pool->_inject_mutex);
+}
+
+static inline task_t* thread_pool_take_injected(thread_pool_t* pool)
+{
+    if (atomic_load_explicit(&pool->_injected, memory_order_relaxed) == 0)
+        return NULL;
+    pthread_mutex_lock(&pool->_inject_mutex);
+    task_t* task = pool->_inject_head;
+    if (task)
+    {
+        pool->_inject_head = task->_next;
+        if (pool->_inject_head == NULL)
+            pool->_inject_tail = NULL;
+        atomic_fetch_sub_explicit(&pool->_injected, 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&pool->_inject_mutex);
+    return task;
+}
+
+/**
+ * @brief Adds a task to the group and makes it runnable. From a worker it
+ * goes on that worker's own deque; from any other thread, on the injection list.
+ */
+static inline void thread_pool_spawn(thread_pool_t* pool, task_group_t* group, task_t* task, task_fn_t fn)
+{
+    task->_fn = fn;
+    task->_group = group;
+    atomic_fetch_add_explicit(&group->_pending, 1, memory_order_relaxed);
+
+    tp_worker_t* self = tp_self;
+    if (self == NULL || self->_pool != pool || !ws_deque_push(&self->_deque, task))
+        thread_pool_inject(pool, task);
+    thread_pool_notify(pool);
+}
+
+/**
+ * @brief Looks for a task: own deque, then the injection list, then the other workers.
+ */
+static inline task_t* thread_pool_find_task(tp_worker_t* self)
+{
+    thread_pool_t* pool = self->_pool;
+    task_t* task = ws_deque_pop(&self->_deque);
+    if (task)
+        return task;
+    if ((task = thread_pool_take_injected(pool)) != NULL)
+        return task;
+
+    // xorshift: thieves start at different victims instead of all hitting worker 0.
+    self->_rng ^= self->_rng << 13;
+    self->_rng ^= self->_rng >> 7;
+    self->_rng ^= self->_rng << 17;
+    int first = (int)(self->_rng % (uint64_t)pool->_count);
+    for (int i = 0; i < pool->_count; ++i)
+    {
+        tp_worker_t* victim = &pool->_workers[(first + i) % pool->_count];
+        if (victim != self && (task = ws_deque_steal(&victim->_deque)) != NULL)
+        {
+            self->_stolen++;
+            return task;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Sleeps until new work is announced or the pool stops, unless a last
+ * look finds a task. Returns that task or NULL.
+ */
+static inline task_t* thread_pool_park(tp_worker_t* self)
+{
+    thread_pool_t* pool = self->_pool;
+    uint32_t epoch = atomic_load_explicit(&pool->_epoch, memory_order_acquire);
+    atomic_fetch_add_explicit(&pool->_sleepers, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    task_t* task = thread_pool_find_task(self);
+    if (task == NULL && !atomic_load_explicit(&pool->_stop, memory_order_acquire))
+    {
+        self->_parks++;
+        futex_wait_private(&pool->_epoch, epoch);
+    }
+    atomic_fetch_sub_explicit(&pool->_sleepers, 1, memory_order_relaxed);
+    return task;
+}
+
+static void* thread_pool_worker(void* arg)
+{
+    tp_worker_t* self = arg;
+    thread_pool_t* pool = self->_pool;
+    tp_self = self;
+
+    unsigned spins = 0;
+    while (!atomic_load_explicit(&pool->_stop, memory_order_acquire))
+    {
+        task_t* task = thread_pool_find_task(self);
+        if (task == NULL && spins >= TP_IDLE_SPINS)
+            task = thread_pool_park(self);
+        if (task == NULL)
+        {
+            spin_backoff(&spins);
+            continue;
+        }
+        spins = 0;
+        task_run(task);
+        self->_executed++;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Waits for every task of the group. A worker runs other tasks while
+ * it waits; any other thread sleeps.
+ */
+static inline void thread_pool_wait(thread_pool_t* pool, task_group_t* group)
+{
+    tp_worker_t* self = tp_self;
+    if (self == NULL || self->_pool != pool)
+    {
+        task_group_sleep(group);
+        return;
+    }
+    unsigned spins = 0;
+    while (atomic_load_explicit(&group->_pending, memory_order_acquire) != 0)
+    {
+        task_t* task = thread_pool_find_task(self);
+        if (task == NULL)
+        {
+            spin_backoff(&spins);
+            continue;
+        }
+        spins = 0;
+        task_run(task);
+        self->_executed++;
+    }
+}
+
+static inline void thread_pool_stop(thread_pool_t* pool);
+static inline void thread_pool_destroy(thread_pool_t* pool);
+
+/**
+ * @brief Starts the workers. Returns 0, or -1 if allocation or thread creation fails.
+ */
+static inline int thread_pool_init(thread_pool_t* pool, int workers)
+{
+    if (workers < 1)
+        return -1;
+    pool->_workers = aligned_alloc(CACHE_LINE_SIZE, workers * sizeof(tp_worker_t));
+    if (pool->_workers == NULL)
+        return -1;
+    pool->_count = workers;
+    pthread_mutex_init(&pool->_inject_mutex, NULL);
+    pool->_inject_head = pool->_inject_tail = NULL;
+    atomic_init(&pool->_injected, 0);
+    atomic_init(&pool->_epoch, 0);
+    atomic_init(&pool->_sleepers, 0);
+    atomic_init(&pool->_stop, 0);
+
+    for (int i = 0; i < workers; ++i)
+    {
+        tp_worker_t* w = &pool->_workers[i];
+        atomic_init(&w->_deque._top, 0);
+        atomic_init(&w->_deque._bottom, 0);
+        w->_pool = pool;
+        w->_index = i;
+        w->_rng = 0x9E3779B97F4A7C15ull * (i + 1);
+        w->_executed = w->_stolen = w->_parks = 0;
+    }
+    for (int i = 0; i < workers; ++i)
+    {
+        if (pthread_create(&pool->_workers[i]._thread, NULL, thread_pool_worker, &pool->_workers[i]) != 0)
+        {
+            pool->_count = i; // Stop only the ones that started
+            thread_pool_stop(pool);
+            thread_pool_destroy(pool);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Stops and joins the workers. Every group must have been waited for.
+ * Worker counters stay readable until the next init.
+ */
+static inline void thread_pool_stop(thread_pool_t* pool)
+{
+    atomic_store_explicit(&pool->_stop, 1, memory_order_release);
+    atomic_fetch_add_explicit(&pool->_epoch, 1, memory_order_release);
+    futex_wake_private(&pool->_epoch, INT_MAX);
+    for (int i = 0; i < pool->_count; ++i)
+        pthread_join(pool->_workers[i]._thread, NULL);
+}
+
+static inline void thread_pool_destroy(thread_pool_t* pool)
+{
+    pthread_mutex_destroy(&pool->_inject_mutex);
+    free(pool->_workers);
+    pool->_workers = NULL;
+}
+
+#endif // THREAD_POOL_H
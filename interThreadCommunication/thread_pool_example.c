@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "bench_common.h"
+#include "thread_pool.h"
+
+// Compile with:
+// gcc -O2 thread_pool_example.c -o thread_pool_example -pthread
+//
+// Usage:
+//   ./thread_pool_example [threads [n [grain]]]
+//
+// A fork/join benchmark: sum f(i) over [0, n) by splitting the range in two
+// until it is at most grain long, so n / grain leaf tasks plus as many inner
+// ones. The same task tree runs on two pools:
+//   - mutex-queue: one list under one mutex and condition variable, the
+//     pattern of condition_variable_example.c; every spawn and every pop takes
+//     the lock. It is used newest-first: a waiting parent that took the oldest
+//     task would start another whole subtree on its stack, and deep trees
+//     would overflow it
+//   - stealing:    the work-stealing pool of thread_pool.h
+// Both count a waiting parent as a worker: it runs queued tasks until its
+// children are done. A serial loop gives the expected sum and the baseline.
+
+#define DEFAULT_N (1l << 24)
+#define DEFAULT_GRAIN 8
+
+// Spawns and waits on whichever pool is being measured.
+typedef struct
+{
+    void (*_spawn)(void* pool, task_group_t* group, task_t* task, task_fn_t fn);
+    void (*_wait)(void* pool, task_group_t* group);
+    void* _pool;
+} pool_api_t;
+
+static pool_api_t api;
+static long grain = DEFAULT_GRAIN;
+
+typedef struct
+{
+    task_t _task;
+    long _lo;
+    long _hi;
+    uint64_t _sum;
+} sum_task_t;
+
+/**
+ * @brief The per-element work: a cheap mix the compiler cannot fold into a closed form.
+ */
+static inline uint64_t element(long i)
+{
+    uint64_t x = (uint64_t)i * 0x9E3779B97F4A7C15ull;
+    return x ^ (x >> 29);
+}
+
+static void sum_range(task_t* task)
+{
+    sum_task_t* s = (sum_task_t*)((char*)task - offsetof(sum_task_t, _task));
+    if (s->_hi - s->_lo <= grain)
+    {
+        uint64_t sum = 0;
+        for (long i = s->_lo; i < s->_hi; ++i)
+            sum += element(i);
+        s->_sum = sum;
+        return;
+    }
+
+    // Spawn the left half for anyone to take, do the right half here.
+    long mid = s->_lo + (s->_hi - s->_lo) / 2;
+    sum_task_t left = { ._lo = s->_lo, ._hi = mid };
+    sum_task_t right = { ._lo = mid, ._hi = s->_hi };
+    task_group_t group;
+    task_group_init(&group);
+    api._spawn(api._pool, &group, &left._task, sum_range);
+    sum_range(&right._task);
+    api._wait(api._pool, &group);
+    s->_sum = left._sum + right._sum;
+}
+
+// --- Baseline: one mutex-protected queue ---
+
+typedef struct
+{
+    pthread_mutex_t _mutex;
+    pthread_cond_t _cond_not_empty;
+    task_t* _head; // Newest task
+    int _stop;
+    pthread_t* _threads;
+    int _count;
+} mutex_pool_t;
+
+static task_t* mutex_pool_try_pop(mutex_pool_t* pool)
+{
+    pthread_mutex_lock(&pool->_mutex);
+    task_t* task = pool->_head;
+    if (task)
+        pool->_head = task->_next;
+    pthread_mutex_unlock(&pool->_mutex);
+    return task;
+}
+
+static void* mutex_pool_worker(void* arg)
+{
+    mutex_pool_t* pool = arg;
+    pthread_mutex_lock(&pool->_mutex);
+    for (;;)
+    {
+        while (pool->_head == NULL && !pool->_stop)
+            pthread_cond_wait(&pool->_cond_not_empty, &pool->_mutex);
+        if (pool->_stop)
+            break;
+        task_t* task = pool->_head;
+        pool->_head = task->_next;
+        pthread_mutex_unlock(&pool->_mutex);
+        task_run(task);
+        pthread_mutex_lock(&pool->_mutex);
+    }
+    pthread_mutex_unlock(&pool->_mutex);
+    return NULL;
+}
+
+static void mutex_pool_spawn(void* p, task_group_t* group, task_t* task, task_fn_t fn)
+{
+    mutex_pool_t* pool = p;
+    task->_fn = fn;
+    task->_group = group;
+    atomic_fetch_add_explicit(&group->_pending, 1, memory_order_relaxed);
+
+    pthread_mutex_lock(&pool->_mutex);
+    task->_next = pool->_head;
+    pool->_head = task;
+    pthread_cond_signal(&pool->_cond_not_empty);
+    pthread_mutex_unlock(&pool->_mutex);
+}
+
+static void mutex_pool_wait(void* p, task_group_t* group)
+{
+    unsigned spins = 0;
+    while (atomic_load_explicit(&group->_pending, memory_order_acquire) != 0)
+    {
+        task_t* task = mutex_pool_try_pop(p);
+        if (task == NULL)
+        {
+            spin_backoff(&spins);
+            continue;
+        }
+        spins = 0;
+        task_run(task);
+    }
+}
+
+static int mutex_pool_init(mutex_pool_t* pool, int threads)
+{
+    pthread_mutex_init(&pool->_mutex, NULL);
+    pthread_cond_init(&pool->_cond_not_empty, NULL);
+    pool->_head = NULL;
+    pool->_stop = 0;
+    pool->_count = threads;
+    pool->_threads = malloc(threads * sizeof(pthread_t));
+    if (pool->_threads == NULL)
+        return -1;
+    for (int i = 0; i < threads; ++i)
+        pthread_create(&pool->_threads[i], NULL, mutex_pool_worker, pool);
+    return 0;
+}
+
+static void mutex_pool_destroy(mutex_pool_t* pool)
+{
+    pthread_mutex_lock(&pool->_mutex);
+    pool->_stop = 1;
+    pthread_cond_broadcast(&pool->_cond_not_empty);
+    pthread_mutex_unlock(&pool->_mutex);
+    for (int i = 0; i < pool->_count; ++i)
+        pthread_join(pool->_threads[i], NULL);
+    free(pool->_threads);
+    pthread_mutex_destroy(&pool->_mutex);
+    pthread_cond_destroy(&pool->_cond_not_empty);
+}
+
+static void stealing_spawn(void* pool, task_group_t* group, task_t* task, task_fn_t fn)
+{
+    thread_pool_spawn(pool, group, task, fn);
+}
+
+static void stealing_wait(void* pool, task_group_t* group)
+{
+    thread_pool_wait(pool, group);
+}
+
+/**
+ * @brief Submits the root task from main and sleeps until the tree is done.
+ * Returns the elapsed nanoseconds and stores the sum.
+ */
+static uint64_t run_tree(long n, uint64_t* sum)
+{
+    sum_task_t root = { ._lo = 0, ._hi = n };
+    task_group_t group;
+    task_group_init(&group);
+
+    uint64_t start = now_ns();
+    api._spawn(api._pool, &group, &root._task, sum_range);
+    task_group_sleep(&group);
+    uint64_t elapsed = now_ns() - start;
+
+    *sum = root._sum;
+    return elapsed;
+}
+
+static void print_row(const char* name, int threads, long tasks, uint64_t elapsed, uint64_t serial,
+                      uint64_t sum, uint64_t expected)
+{
+    printf("%-12s %7d %10ld %10.1f %12.2f %8.2f  %s", name, threads, tasks, elapsed / 1e6,
+           tasks / (elapsed / 1e9) / 1e6, (double)serial / elapsed, sum == expected ? "ok" : "WRONG");
+}
+
+int main(int argc, char* argv[])
+{
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    long n = DEFAULT_N;
+
+    if (argc > 4)
+    {
+        fprintf(stderr, "usage: %s [threads [n [grain]]]\n", argv[0]);
+        return 1;
+    }
+    if (argc >= 2)
+        threads = atoi(argv[1]);
+    if (argc >= 3)
+        n = atol(argv[2]);
+    if (argc >= 4)
+        grain = atol(argv[3]);
+    if (threads < 1 || n < 1 || grain < 1)
+    {
+        fprintf(stderr, "Need at least one thread, one element and a grain of one.\n");
+        return 1;
+    }
+
+    // Leaves hold grain elements or fewer; every split spawns one task.
+    long leaves = 1;
+    for (long len = n; len > grain; len = (len + 1) / 2)
+        leaves *= 2;
+    long tasks = leaves; // Root plus one spawn per split (leaves - 1)
+
+    uint64_t start = now_ns();
+    uint64_t expected = 0;
+    for (long i = 0; i < n; ++i)
+        expected += element(i);
+    uint64_t serial = now_ns() - start;
+
+    printf("Sum of %ld elements, grain %ld: about %ld tasks\n\n", n, grain, tasks);
+    printf("%-12s %7s %10s %10s %12s %8s  %s\n", "pool", "threads", "tasks", "ms", "Mtasks/sec", "speedup",
+           "result");
+    printf("%-12s %7d %10s %10.1f %12s %8.2f  %s\n", "serial", 1, "-", serial / 1e6, "-", 1.0, "ok");
+
+    uint64_t sum;
+    int failed = 0;
+
+    mutex_pool_t mutex_pool;
+    if (mutex_pool_init(&mutex_pool, threads) != 0)
+    {
+        perror("mutex_pool_init");
+        return 1;
+    }
+    api = (pool_api_t){ mutex_pool_spawn, mutex_pool_wait, &mutex_pool };
+    uint64_t elapsed = run_tree(n, &sum);
+    mutex_pool_destroy(&mutex_pool);
+    print_row("mutex-queue", threads, tasks, elapsed, serial, sum, expected);
+    printf("\n");
+    failed |= sum != expected;
+
+    thread_pool_t pool;
+    if (thread_pool_init(&pool, threads) != 0)
+    {
+        perror("thread_pool_init");
+        return 1;
+    }
+    api = (pool_api_t){ stealing_spawn, stealing_wait, &pool };
+    elapsed = run_tree(n, &sum);
+    thread_pool_stop(&pool);
+    unsigned long stolen = 0, parks = 0;
+    for (int i = 0; i < pool._count; ++i)
+    {
+        stolen += pool._workers[i]._stolen;
+        parks += pool._workers[i]._parks;
+    }
+    print_row("stealing", threads, tasks, elapsed, serial, sum, expected);
+    printf("  (%lu steals, %lu parks)\n", stolen, parks);
+    thread_pool_destroy(&pool);
+    failed |= sum != expected;
+
+    return failed ? 1 : 0;
+}